@@ -0,0 +1,140 @@
+/**
+# Adaptive tolerance of the multigrid solvers
+
+`main()` sets a single `TOLERANCE` for all the multigrid solves of the
+run (the projections and the viscous solve of
+[centered.h](http://basilisk.fr/src/navier-stokes/centered.h)). With
+the density ratio of the case the projections are expensive while the
+cavity collapses, and the same tolerance is then paid for during the
+slow relaxation which follows.
+
+At the end of every step the iterations of the solves are added to the
+total work, which is printed at the end of the run. With
+`-DSOLVER_LOG=1`, the iterations and residuals of the solves of the step
+are also appended to `solver`, one line per step:
+
+~~~
+i t dt tol cap ipf ip iu resb resa ke vjet work active
+~~~
+
+with `ipf`, `ip` and `iu` the iterations of the prediction, of the
+projection and of the viscous solve, `resb` and `resa` the residual of
+the projection before and after, `ke` the kinetic energy of the
+liquid, `vjet` the jet velocity (largest axial velocity of the liquid
+on the axis) and `work` the iterations times the number of leaf cells.
+The kinetic energy and the jet velocity take a reduction over the leaf
+cells, and the log an `fopen()` per step, so neither is done by default.
+
+With `-DADAPTIVE_TOLERANCE=1`, the tolerance and the iteration cap of
+the next step are then set from the state of the run. The step is
+*active* if
+
+- the cavity is closer than `tol_gap` to its collapse ($h_\infty - x_a$,
+  see [milestones.h](milestones.h)), or the collapse or a change of the
+  number of droplets happened less than `tol_window` ago,
+- the kinetic energy of the liquid changes faster than `tol_ke_rate`
+  ($|d \ln E_k/dt|$),
+- a solve of the step stopped at its iteration cap, or the initial
+  residual of the projection is more than `tol_jump` times that of the
+  previous step.
+
+An active step gets back the tolerance set by `main()` and the cap
+`NITERMAX`. After a quiet step the tolerance grows by a factor
+`tol_relax`, up to `tol_max`, and the cap is `tol_itercap`. The
+reduction is then done at every step, since the rate of change of the
+kinetic energy is one of the criteria.
+
+[tolerance-study.sh](tolerance-study.sh) runs one case with the fixed
+and with the adaptive tolerance, and compares the work, the kinetic
+energy and jet velocity histories and the milestone times. */
+
+#include "milestones.h"
+
+#ifndef ADAPTIVE_TOLERANCE
+# define ADAPTIVE_TOLERANCE 0
+#endif
+#ifndef SOLVER_LOG
+# define SOLVER_LOG 0
+#endif
+
+double tol_max = 1e-3;       // loosest tolerance of the quiet phases
+double tol_relax = 1.2;      // growth of the tolerance per quiet step
+double tol_gap = 0.2;        // active while the cavity is closer to collapse
+double tol_window = 0.05;    // active for this time after a topology change
+double tol_ke_rate = 2.;     // active while |d ln(ke)/dt| is larger
+double tol_jump = 10.;       // active when the projection residual jumps
+int tol_itercap = 30;        // iteration cap of the quiet phases
+
+static struct {
+  double tol0;               // tolerance set by main()
+  int cap0;                  // NITERMAX at the start
+  double ke, resb, tevent;
+  int ndrops;
+  long steps, active;
+  double work, iters;
+} tol_state = {.tevent = - HUGE};
+
+event solver_control (i++)
+{
+  if (tol_state.cap0 == 0)
+    tol_state.tol0 = TOLERANCE, tol_state.cap0 = NITERMAX;
+
+  int iters = mgpf.i + mgp.i + mgu.i;
+  double work = (double) iters*grid->tn;
+  tol_state.work += work, tol_state.iters += iters, tol_state.steps++;
+
+#if ADAPTIVE_TOLERANCE || SOLVER_LOG
+  double ke = 0., vjet = 0.;
+  foreach (reduction(+:ke) reduction(max:vjet)) {
+    ke += 2.*pi*y*0.5*f[]*(sq(u.x[]) + sq(u.y[]))*sq(Delta);
+    if (y < Delta && f[] > 0.5 && u.x[] > vjet)
+      vjet = u.x[];
+  }
+
+  /**
+  The state of the step. */
+
+  if (milestone_time[0] >= 0. && tol_state.tevent < milestone_time[0])
+    tol_state.tevent = milestone_time[0];
+  if (milestone_ndrops != tol_state.ndrops)
+    tol_state.tevent = t, tol_state.ndrops = milestone_ndrops;
+  double rate = ke > 0. && i > 0 ? fabs (ke - tol_state.ke)/(dt*ke) : HUGE;
+  bool capped = mgp.i >= NITERMAX || mgpf.i >= NITERMAX || mgu.i >= NITERMAX;
+  bool active = (milestone_time[0] < 0. && milestone_gap < tol_gap) ||
+    t - tol_state.tevent < tol_window ||
+    rate > tol_ke_rate || capped ||
+    (tol_state.resb > 0. && mgp.resb > tol_jump*tol_state.resb);
+  tol_state.ke = ke, tol_state.resb = mgp.resb;
+  tol_state.active += active;
+
+#if SOLVER_LOG
+  FILE * fp = fopen ("solver", i == 0 ? "w" : "a");
+  if (i == 0)
+    fprintf (fp, "i t dt tol cap ipf ip iu resb resa ke vjet work active\n");
+  fprintf (fp, "%d %g %g %g %d %d %d %d %g %g %g %g %g %d\n", i, t, dt,
+	   TOLERANCE, NITERMAX, mgpf.i, mgp.i, mgu.i, mgp.resb, mgp.resa,
+	   ke, vjet, work, active);
+  fclose (fp);
+#endif
+
+  /**
+  The tolerance and the cap of the next step. */
+
+#if ADAPTIVE_TOLERANCE
+  if (active)
+    TOLERANCE = tol_state.tol0, NITERMAX = tol_state.cap0;
+  else {
+    TOLERANCE = min (TOLERANCE*tol_relax, tol_max);
+    NITERMAX = min (tol_itercap, tol_state.cap0);
+  }
+#endif
+#endif // ADAPTIVE_TOLERANCE || SOLVER_LOG
+}
+
+event end (t = end)
+{
+  if (tol_state.steps)
+    fprintf (ferr, "# solver: %ld steps (%ld active), %g iterations, "
+	     "work %g iterations x cells\n", tol_state.steps, tol_state.active,
+	     tol_state.iters, tol_state.work);
+}
@@ -0,0 +1,249 @@
+/**
+# Benchmark mode
+
+Compiled into `burst_evp.c` with `-DBENCHMARK=1`, the simulation runs
+a fixed number of time steps of one of the parameter sets `bench_presets`
+from a stored checkpoint, and writes a machine-readable report:
+
+~~~bash
+./burst_evp_bench <preset> [steps]
+~~~
+
+The checkpoint of a preset is `bench-<preset>.dump`. If it does not
+exist, the case is run from the initial shape up to `bench_t0`, the
+checkpoint is written and the run stops; the following runs of the
+preset all start from it.
+
+After `bench_warmup` steps, every event of the run is timed for
+`bench_steps` steps (the action of each event is wrapped with a timer,
+so the time of the events of the solver, of the model and of the
+diagnostics is split by event name). The report
+`benchmark-<preset>.json` contains
+
+- the preset, the number of threads and their placement
+  (`OMP_PROC_BIND`, `OMP_PLACES`), the build and the host,
+- the wall-clock time per step, the mean number of leaf cells and the
+  number of cell updates per second,
+- the time per step of each event (`other` is the time spent outside
+  the events),
+- the peak resident set size and the number of bytes written during
+  the timed steps (`wchar` of `/proc/self/io`).
+
+[run-benchmarks.sh](run-benchmarks.sh) builds this mode and runs all
+the presets with pinned threads;
+[compare-benchmarks.py](compare-benchmarks.py) compares two sets of
+reports. */
+
+#include <unistd.h>
+#include <sys/resource.h>
+
+typedef struct {
+  const char * name;
+  double J, De;
+} BenchPreset;
+
+BenchPreset bench_presets[] = {
+  {"lowDe-highJ", 1.0, 0.01},
+  {"mid",         0.1, 0.04},
+  {"highDe",      0.1, 20.},
+  {NULL}
+};
+
+int bench_steps = 200;         // timed steps
+int bench_warmup = 5;          // steps before the timing starts
+double bench_t0 = 0.1;         // time of the checkpoint
+#ifndef BENCH_BUILD
+# define BENCH_BUILD "unknown"
+#endif
+
+static BenchPreset * bench_preset;
+static char bench_dump[80];
+static bool bench_prepare;     // no checkpoint yet: write it and stop
+
+/**
+Selects the preset `name` and returns the checkpoint to restore. */
+
+const char * bench_setup (const char * name, double * J, double * De)
+{
+  for (BenchPreset * p = bench_presets; p->name && !bench_preset; p++)
+    if (!strcmp (p->name, name))
+      bench_preset = p;
+  if (!bench_preset) {
+    fprintf (ferr, "benchmark: unknown preset '%s', use one of:", name);
+    for (BenchPreset * p = bench_presets; p->name; p++)
+      fprintf (ferr, " %s", p->name);
+    fputc ('\n', ferr);
+    exit (1);
+  }
+  *J = bench_preset->J, *De = bench_preset->De;
+  sprintf (bench_dump, "bench-%s.dump", name);
+  bench_prepare = access (bench_dump, R_OK) != 0;
+  if (bench_prepare)
+    fprintf (ferr, "benchmark: no %s, running to t = %g to write it\n",
+	     bench_dump, bench_t0);
+  return bench_dump;
+}
+
+/**
+## Timing of the events */
+
+#define BENCH_MAXEVENTS 256
+
+static struct {
+  Event * ev;
+  int (* action) (const int, const double, Event *);
+  int slot;
+} bench_wrap[BENCH_MAXEVENTS];
+static int bench_nwrap;
+
+static struct {
+  const char * name;
+  long calls;
+  double time;
+} bench_event[BENCH_MAXEVENTS];
+static int bench_nevent;
+
+static int bench_action (const int i, const double t, Event * ev)
+{
+  int w = 0;
+  while (bench_wrap[w].ev != ev)
+    w++;
+  timer tm = timer_start();
+  int ret = bench_wrap[w].action (i, t, ev);
+  bench_event[bench_wrap[w].slot].time += timer_elapsed (tm);
+  bench_event[bench_wrap[w].slot].calls++;
+  return ret;
+}
+
+static void bench_wrap_events()
+{
+  for (Event * ev = Events; !ev->last; ev++)
+    for (Event * e = ev; e; e = e->next) {
+      if (!strncmp (e->name, "bench_", 6) || e->action == bench_action)
+	continue;
+      assert (bench_nwrap < BENCH_MAXEVENTS);
+      int s = 0;
+      while (s < bench_nevent && strcmp (bench_event[s].name, e->name))
+	s++;
+      if (s == bench_nevent)
+	bench_event[bench_nevent++].name = e->name;
+      bench_wrap[bench_nwrap].ev = e;
+      bench_wrap[bench_nwrap].action = e->action;
+      bench_wrap[bench_nwrap++].slot = s;
+      e->action = bench_action;
+    }
+}
+
+static long bench_wchar()
+{
+  long w = 0;
+  FILE * fp = fopen ("/proc/self/io", "r");
+  if (fp) {
+    char line[128];
+    while (fgets (line, sizeof(line), fp))
+      if (sscanf (line, "wchar: %ld", &w) == 1)
+	break;
+    fclose (fp);
+  }
+  return w;
+}
+
+/**
+## Timed steps */
+
+static struct {
+  int i0;
+  double t0, cells;
+  long wchar;
+  timer tm;
+} bench;
+
+event bench_checkpoint (t = bench_t0)
+{
+  if (bench_prepare) {
+    dump (file = bench_dump);
+    fprintf (ferr, "benchmark: wrote %s, run again to time the preset\n",
+	     bench_dump);
+    return 1;
+  }
+}
+
+static void bench_report (int steps);
+
+event bench_step (i++)
+{
+  if (bench_prepare)
+    return 0;
+  static int istart = -1;
+  if (istart < 0) {
+    istart = i;
+    bench_wrap_events();
+  }
+  if (i == istart + bench_warmup) {
+    for (int s = 0; s < bench_nevent; s++)
+      bench_event[s].calls = 0, bench_event[s].time = 0.;
+    bench.i0 = i, bench.t0 = t, bench.cells = 0.;
+    bench.wchar = bench_wchar();
+    bench.tm = timer_start();
+  }
+  else if (i > istart + bench_warmup)
+    bench.cells += grid->tn;
+  if (i == istart + bench_warmup + bench_steps) {
+    bench_report (bench_steps);
+    return 1;
+  }
+  return 0;
+}
+
+/**
+## Report */
+
+static void bench_report (int steps)
+{
+  double wall = timer_elapsed (bench.tm), events = 0.;
+  long bytes = bench_wchar() - bench.wchar;
+  struct rusage ru;
+  getrusage (RUSAGE_SELF, &ru);
+  char host[64] = "unknown", date[32];
+  gethostname (host, sizeof(host) - 1);
+  time_t now = time (NULL);
+  strftime (date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime (&now));
+  const char * bind = getenv ("OMP_PROC_BIND"), * places = getenv ("OMP_PLACES");
+#if _OPENMP
+  int threads = omp_get_max_threads(); // npe() is 1 out of a parallel region
+#else
+  int threads = npe();
+#endif
+
+  char name[80];
+  sprintf (name, "benchmark-%s.json", bench_preset->name);
+  FILE * fp = fopen (name, "w");
+  fprintf (fp, "{\n"
+	   "  \"preset\": \"%s\",\n  \"J\": %g,\n  \"De\": %g,\n"
+	   "  \"checkpoint\": \"%s\",\n  \"build\": \"%s\",\n"
+	   "  \"compiler\": \"%s\",\n  \"host\": \"%s\",\n  \"date\": \"%s\",\n"
+	   "  \"threads\": %d,\n  \"omp_proc_bind\": \"%s\",\n"
+	   "  \"omp_places\": \"%s\",\n",
+	   bench_preset->name, bench_preset->J, bench_preset->De,
+	   bench_dump, BENCH_BUILD, __VERSION__, host, date, threads,
+	   bind ? bind : "", places ? places : "");
+  fprintf (fp, "  \"steps\": %d,\n  \"t0\": %.17g,\n  \"t1\": %.17g,\n"
+	   "  \"wall\": %g,\n  \"time_per_step\": %g,\n"
+	   "  \"cells_per_step\": %g,\n  \"cell_updates_per_second\": %g,\n"
+	   "  \"peak_rss_kb\": %ld,\n  \"output_bytes\": %ld,\n"
+	   "  \"events\": {\n",
+	   steps, bench.t0, t, wall, wall/steps, bench.cells/steps,
+	   bench.cells/wall, ru.ru_maxrss, bytes);
+  for (int s = 0; s < bench_nevent; s++) {
+    events += bench_event[s].time;
+    fprintf (fp, "    \"%s\": {\"calls\": %ld, \"time_per_step\": %g},\n",
+	     bench_event[s].name, bench_event[s].calls,
+	     bench_event[s].time/steps);
+  }
+  fprintf (fp, "    \"other\": {\"calls\": %d, \"time_per_step\": %g}\n"
+	   "  }\n}\n", steps, (wall - events)/steps);
+  fclose (fp);
+  fprintf (ferr, "benchmark: %s, %d steps, %g s/step, %g cell updates/s, "
+	   "report in %s\n", bench_preset->name, steps, wall/steps,
+	   bench.cells/wall, name);
+}
@@ -13,15 +13,29 @@
  *
  * Output files:
  * - intermediate/snapshot-*.dat: Simulation states
+ * - dump: Restart file; full dumps and deltas dump-delta-*, with -DCHECKPOINT_FULL=n (see checkpoint.h)
+ * - checkpoints: Bytes and time of each checkpoint, with -DCHECKPOINT_FULL=n (see checkpoint.h)
  * - timestep.txt: Time stepping data
  * - log: Kinetic energy and diagnostics
+ * - budget: Energy budget time series, with -DENERGY_BUDGET=1 (see energy-budget.h)
+ * - topology, topology-hist: Flow-topology statistics, with -DFLOW_TOPOLOGY=1 (see flow-topology.h)
+ * - intermediate/contours-*: Interface and yield-surface polylines, with -DCONTOURS=1 (see contours.h)
+ * - droplets: Volume, centroid and velocity of each liquid component, with -DDROPLETS=1 (see droplets.h)
+ * - milestones, milestones-state: Times of cavity collapse, jet emergence, pinch-off and rest, and the state read back on a restart, with -DMILESTONES=1 (see milestones.h)
+ * - solver: Multigrid iterations, residuals and tolerance of each step, with -DSOLVER_LOG=1 (see adaptive-tolerance.h)
+ * - memory, memory-fields: Cells per level, fields and bytes per group and resident memory, with -DMEMORY_REPORT=1 (see memory-report.h)
+ * - frames/frame-*.ppm: Movie frames, with -DRENDER_FRAMES=1 (see render-frames.h)
+ * - intermediate/{interface,yield}-*.ply: Revolved surfaces, with -DEXPORT_MESH=1 (see revolve-mesh.h)
+ * - shared-memory frames /burst_evp, with -DSHM_PUBLISH=1 (see shm-publish.h)
+ * - intermediate/lod-*: Snapshots stored coarse to fine, with -DLOD_SNAPSHOTS=1 (see output-lod.h)
+ * - benchmark-<preset>.json: Timing report, with -DBENCHMARK=1 (see benchmark.h)
  */
 
 #include "axi.h"
 #include "navier-stokes/centered.h"
 #include "two-phase.h"
 #include "navier-stokes/conserving.h"
-#include "tension.h"
+#include "tension-cached.h" // tension.h with the curvature shared with the adapt event
 
 // we modify the [log-conform.h](http://basilisk.fr/src/log-conform.h) and [fene-p.h](http://basilisk.fr/src/fene-p.h) files to implement the Saramito model:
 #include "log-conform-EVP.h"
@@ -29,9 +43,53 @@
 
 #include "distance.h"
 #include "adapt_wavelet_limited.h"
+#if FLOW_TOPOLOGY
+#include "flow-topology.h" // in the traversal of the budget with -DENERGY_BUDGET=1
+#endif
+#if ENERGY_BUDGET
+#include "energy-budget.h"
+#endif
+#if CONTOURS
+#include "contours.h"
+#endif
+#if DROPLETS
+#include "droplets.h" // liquid components labelled every droplet_dt
+#endif
+#if MILESTONES
+#include "milestones.h" // collapse, jet, pinch-off and rest; may end the run
+#endif
+#if ADAPTIVE_TOLERANCE || SOLVER_LOG
+#include "adaptive-tolerance.h" // solver log, tolerance from the state of the run (uses milestones.h)
+#endif
+#if MEMORY_REPORT
+#include "memory-report.h" // bytes per level and per field, after adapt
+#endif
+#if CHECKPOINT_FULL
+#include "checkpoint.h" // restart file as full dumps and deltas
+#endif
+#if RENDER_FRAMES
+#include "render-frames.h" // movie frames written during the run
+#endif
+#if EXPORT_MESH
+#include "revolve-mesh.h" // PLY meshes of the interface and yield surface
+#endif
+#if LOD_SNAPSHOTS
+#include "output-lod.h" // snapshots stored level by level, previewed from a prefix
+#endif
+#if SHM_PUBLISH
+#include "shm-publish.h" // frames published to a shared-memory ring for a local consumer
+#endif
+#if NUMA
+#include "numa.h" // threads pinned, leaf cells moved to the node of their thread
+#endif
+#if BENCHMARK
+#include "benchmark.h" // fixed steps of a preset from a checkpoint, timed by event
+#endif
 
 // Simulation parameters
+#ifndef tmax
 #define tmax 4.5      // Maximum simulation time
+#endif
 #define LEVEL 8       // Base refinement level
 #define MAXlevel 11   // Maximum refinement level
 #define DT_MAX 0.0005 // Maximum timestep
@@ -53,7 +111,7 @@ u.n[right] = neumann(0.);
 p[right] = dirichlet(0.);
 
 double Bond, J, Deb;
-char nameOut[80], namepng[80], dumpFile[80];
+char nameOut[80], namepng[80], dumpFile[80], restoreFile[80];
 
 /**
  * @brief Initialize material properties and create output directories
@@ -70,8 +128,26 @@ origin (-L0/2., 0.);
 init_grid (1 << 8);
 Bond = 0.001;
 
+sprintf (dumpFile, "dump");
+sprintf (restoreFile, "%s", dumpFile);
+
+#if BENCHMARK
+// ./burst_evp_bench preset [steps]
+sprintf (restoreFile, "%s", bench_setup (argc > 1 ? argv[1] : "mid", &J, &Deb));
+sprintf (dumpFile, "bench-restart");
+if (argc > 2)
+  bench_steps = atoi(argv[2]);
+#else
 J = atof(argv[1]); // Plastocapillary number
 Deb = atof(argv[2]); // Deborah number
+#if MILESTONES || ADAPTIVE_TOLERANCE || SOLVER_LOG
+if (argc > 3)
+  milestone_stop = milestone_parse (argv[3]); // e.g. "rest", "pinch,rest" or "none"
+#else
+if (argc > 3)
+  fprintf (ferr, "stop milestones need -DMILESTONES=1, ignoring '%s'\n", argv[3]);
+#endif
+#endif
 
 char comm[80];
 sprintf (comm, "mkdir -p intermediate");
@@ -80,8 +156,6 @@ sprintf (comm, "mkdir -p 01_pp/png");
 system(comm);
 sprintf (comm, "mkdir -p 01_pp/pdf");
 system(comm);
- 
-sprintf (dumpFile, "dump");
 
 rho1 = 1., mu1 = 0.01*B;
 rho2 = 0.001, mu2 = 0.0002, f.sigma = 1.0;
@@ -92,7 +166,10 @@ lambda=lambdav;
 mup=mupv;
 tau0=tau0v;
 
-TOLERANCE = 1e-5;
+TOLERANCE = 1e-5; // of the active phases with -DADAPTIVE_TOLERANCE=1
+#if CHECKPOINT_FULL
+checkpoint_full = CHECKPOINT_FULL; // full dumps every CHECKPOINT_FULL checkpoints, deltas in between
+#endif
 
 run();
 }
@@ -124,7 +201,12 @@ int refRegion(double x, double y, double z){
 }
 
 event init (t = 0) {
-  if (!restore (file = dumpFile)){
+  evp_diagnostics_allocate(); // the dumps hold trA and solidreg
+#if CHECKPOINT_FULL
+  if (!checkpoint_restore (restoreFile)){
+#else
+  if (!restore (file = restoreFile)){
+#endif
     // read the initial shape from a data file.
     char filename[60];
     sprintf(filename,"Bo%5.4f.dat",Bond);
@@ -159,8 +241,9 @@ event properties (i++) {
 
 event adapt(i++){
 
-  scalar KAPPA[], Axx[], Axy[], Ayy[], Aqq[];
-  curvature(f, KAPPA);
+  scalar KAPPA = interface_curvature (f); // computed once per step, see tension-cached.h
+  evp_diagnostics(); // trA and solidreg, see log-conform-EVP.h
+  scalar Axx[], Axy[], Ayy[], Aqq[];
   foreach()
     {
         Axx[] = f[]*(((1.-B)*0.01)/Deb)*tau_p.x.x[];
@@ -174,13 +257,29 @@ event adapt(i++){
  }
 
 event writingFiles (t = 0; t += tsnap; t <= tmax) {
+  evp_diagnostics();
+#if CHECKPOINT_FULL
+  checkpoint (dumpFile);
+#else
   dump (file = dumpFile);
+#endif
   sprintf (nameOut, "intermediate/snapshot-%5.4f", t);
   dump(file=nameOut);
+#if LOD_SNAPSHOTS
+  sprintf (nameOut, "intermediate/lod-%5.4f", t);
+  FILE * fp = fopen (nameOut, "w");
+  if (fp) {
+    output_lod ({f, u.x, u.y, p, tau_p.x.x, tau_p.x.y, tau_p.y.y, solidreg}, fp);
+    fclose (fp);
+  }
+#endif
 }
 
 event end (t = end) {
   fprintf(ferr, "Done: \n");
+#if ADAPT_WAVELET_CHECK
+  fprintf(ferr, "# adapt_wavelet_limited: %g s\n", adapt_wavelet_time);
+#endif
 }
 
 // logging on the run data
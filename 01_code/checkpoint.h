@@ -0,0 +1,472 @@
+/**
+# Incremental restart checkpoints
+
+`checkpoint (name)` replaces the `dump (file = name)` of the restart
+file. Every `checkpoint_full` calls (1 by default, i.e. always) it
+writes a full dump `name`
+(Basilisk's [dump()](http://basilisk.fr/src/output.h)). In between it
+writes *delta* checkpoints `name-delta-<k>`, which hold
+
+- the structure of the tree (one byte per cell),
+- for each leaf cell, only the fields of `checkpoint_list` which
+  changed by more than `checkpoint_tol` times the largest value of the
+  field since the last checkpoint which wrote them. Cells created or
+  coarsened since the previous checkpoint are written in full.
+
+Far from the cavity most cells do not change between two snapshots
+and cost one byte. The fields computed from the others at the start
+of a step are not in the deltas: the material properties (`mupv`,
+`lambdav`, `tau0v`, see the `properties` events), the face velocity
+(recomputed from `u` as in the `init` event of
+[centered.h](http://basilisk.fr/src/navier-stokes/centered.h)),
+the reference copy of the stress, equal to `tau_p` at the end of a
+step (see [log-conform-EVP.h](log-conform-EVP.h)), and the diagnostic
+fields.
+
+`checkpoint_restore (name)` restores the full dump, then applies the
+deltas `name-delta-1`, `name-delta-2`, ... of this dump in order. For
+each delta the tree is rebuilt from its structure, as in Basilisk's
+`restore()`, and the leaf cells which were not written take their
+values from the previous state. The face velocity is recomputed
+from the restored `u`; the other fields which are not in the deltas
+are set to zero and recomputed by the events of the first step. A
+restarted run thus differs from an uninterrupted one by the tolerance
+on the fields of the deltas, and by the first time step, which
+`timestep()` computes without the previous one.
+[restart-check.sh](restart-check.sh) compares a restarted run with an
+uninterrupted one.
+
+To know which values changed, the value written last for each leaf
+cell is kept on the tree in single precision, two values per field
+slot (about half a slot per field of the list), and a flag of the cell
+tells whether the cell existed at the previous checkpoint. The
+tolerance should thus not be smaller than the precision of a float
+($10^{-7}$). These reference fields are refined and coarsened with the
+tree, so they are only allocated when deltas are written, that is
+with `checkpoint_full > 1` (set before `run()`, e.g. 10) and without
+MPI. With the default every checkpoint is a full dump, as with
+`dump()`, and costs no memory.
+
+Each checkpoint appends a line
+
+~~~
+i t kind k bytes full cells leaves values time
+~~~
+
+to `checkpoints`, with `kind` 0 for a full dump and 1 for a delta,
+`bytes` the size written, `full` the size of the last full dump,
+`values` the number of values written and `time` the time spent. The
+time of the restore of the full dump and of the deltas is printed when
+restarting. With MPI, `checkpoint()` always writes full dumps. */
+
+#include <sys/stat.h>
+
+int checkpoint_full = 1;          // checkpoints between two full dumps (1: no deltas)
+double checkpoint_tol = 1e-6;     // relative change written in the deltas
+scalar * checkpoint_list = NULL;  // fields of the deltas (default below)
+
+#define CHECKPOINT_MAGIC "EVPDELTA"
+#define CHECKPOINT_MAXFIELDS 32
+
+typedef struct {
+  char magic[8];
+  int32_t version, k, nf, i;
+  double t, base;                 // time of the checkpoint, of the full dump
+} CheckpointHeader;
+
+typedef union { double d; float f[2]; } checkpoint_pair;
+
+typedef struct {
+  long bytes, cells, leaves, values;
+} CheckpointStats;
+
+static struct {
+  scalar * ref;                   // values written last, two per slot
+  char name[80];                  // full dump the deltas apply to
+  double base;
+  int k, count;
+  long full;                      // bytes of the last full dump
+} ckpt = {.base = - HUGE};
+
+static const int checkpoint_valid = 1 << (user + 4);
+
+/**
+## Reference values
+
+New cells are not valid, and neither are the leaf cells which result
+from coarsening. */
+
+static void checkpoint_ref_refine (Point point, scalar s)
+{
+  foreach_child()
+    cell.flags &= ~checkpoint_valid;
+}
+
+static void checkpoint_ref_restriction (Point point, scalar s)
+{
+  cell.flags &= ~checkpoint_valid;
+}
+
+static inline float checkpoint_ref_get (Point point, int k)
+{
+  scalar r = ckpt.ref[k/2];
+  checkpoint_pair c = {.d = r[]};
+  return c.f[k % 2];
+}
+
+static inline void checkpoint_ref_set (Point point, int k, double v)
+{
+  scalar r = ckpt.ref[k/2];
+  checkpoint_pair c = {.d = r[]};
+  c.f[k % 2] = v;
+  r[] = c.d;
+}
+
+/**
+After a full dump or a restore, the references are the current values
+of all the leaf cells. */
+
+static CheckpointStats checkpoint_reset()
+{
+  CheckpointStats c = {0};
+  foreach_cell() {
+    c.cells++;
+    if (is_leaf (cell)) {
+      int k = 0;
+      if (ckpt.ref)
+	for (scalar s in checkpoint_list)
+	  checkpoint_ref_set (point, k++, s[]);
+      cell.flags |= checkpoint_valid;
+      c.leaves++;
+      continue;
+    }
+  }
+  return c;
+}
+
+event defaults (i = 0)
+{
+#if !_MPI
+  if (!checkpoint_list) {
+    checkpoint_list = list_concat ((scalar *){f, p, pf}, (scalar *){u, g});
+    checkpoint_list = list_append (checkpoint_list, tau_p.x.x);
+    checkpoint_list = list_append (checkpoint_list, tau_p.x.y);
+    checkpoint_list = list_append (checkpoint_list, tau_p.y.y);
+#if AXI
+    checkpoint_list = list_append (checkpoint_list, tau_qq);
+#endif
+  }
+  int nf = list_len (checkpoint_list);
+  if (nf > CHECKPOINT_MAXFIELDS) {
+    fprintf (ferr, "checkpoint: only the first %d fields are written\n",
+	     CHECKPOINT_MAXFIELDS);
+    checkpoint_list[CHECKPOINT_MAXFIELDS].i = -1;
+    nf = CHECKPOINT_MAXFIELDS;
+  }
+  if (checkpoint_full > 1)
+    for (int k = 0; k < (nf + 1)/2; k++) {
+      scalar r = new scalar;
+      r.nodump = true;
+      r.refine = checkpoint_ref_refine;
+      r.prolongation = refine_injection;
+      r.restriction = checkpoint_ref_restriction;
+      ckpt.ref = list_append (ckpt.ref, r);
+    }
+#endif
+}
+
+/**
+## Writing */
+
+static void checkpoint_log (int kind, CheckpointStats c, double time)
+{
+  static bool first = true;
+  FILE * fp = fopen ("checkpoints", first ? "w" : "a");
+  if (first)
+    fprintf (fp, "i t kind k bytes full cells leaves values time\n");
+  first = false;
+  fprintf (fp, "%d %g %d %d %ld %ld %ld %ld %ld %g\n", i, t, kind, ckpt.k,
+	   c.bytes, ckpt.full, c.cells, c.leaves, c.values, time);
+  fclose (fp);
+}
+
+static CheckpointStats checkpoint_delta (const char * name)
+{
+  CheckpointStats c = {0};
+  int nf = list_len (checkpoint_list);
+  double tol[nf];
+  int k = 0;
+  for (scalar s in checkpoint_list) {
+    double m = 0.;
+    foreach (reduction(max:m))
+      if (fabs(s[]) > m)
+	m = fabs(s[]);
+    tol[k++] = checkpoint_tol*m;
+  }
+
+  char tmp[100];
+  sprintf (tmp, "%s.tmp", name);
+  FILE * fp = fopen (tmp, "w");
+  if (!fp) {
+    perror (tmp);
+    return c;
+  }
+  CheckpointHeader h = {.version = 1, .k = ckpt.k, .nf = nf, .i = i,
+			.t = t, .base = ckpt.base};
+  memcpy (h.magic, CHECKPOINT_MAGIC, 8);
+  fwrite (&h, sizeof(h), 1, fp);
+  for (scalar s in checkpoint_list) {
+    char field[64] = {0};
+    strncpy (field, s.name, 63);
+    fwrite (field, 1, 64, fp);
+  }
+  fwrite (tol, sizeof(double), nf, fp);
+
+  /**
+  One byte per cell: bit 0 for a leaf cell, bit 1 if some fields
+  follow (with their mask), bit 2 if all the fields follow. */
+
+  foreach_cell() {
+    c.cells++;
+    if (!is_leaf (cell))
+      fputc (0, fp);
+    else {
+      bool fresh = !(cell.flags & checkpoint_valid);
+      uint32_t mask = 0;
+      if (!fresh) {
+	k = 0;
+	for (scalar s in checkpoint_list) {
+	  if (fabs (s[] - checkpoint_ref_get (point, k)) > tol[k])
+	    mask |= 1u << k;
+	  k++;
+	}
+      }
+      fputc (1 | (fresh ? 4 : mask ? 2 : 0), fp);
+      if (!fresh && mask)
+	fwrite (&mask, sizeof(uint32_t), 1, fp);
+      k = 0;
+      for (scalar s in checkpoint_list) {
+	if (fresh || (mask & (1u << k))) {
+	  double v = s[];
+	  fwrite (&v, sizeof(double), 1, fp);
+	  checkpoint_ref_set (point, k, v);
+	  c.values++;
+	}
+	k++;
+      }
+      cell.flags |= checkpoint_valid;
+      c.leaves++;
+      continue;
+    }
+  }
+  c.bytes = ftell (fp);
+  fclose (fp);
+  rename (tmp, name);
+  return c;
+}
+
+void checkpoint (const char * name)
+{
+#if _MPI
+  dump (file = name);
+#else
+  timer tm = timer_start();
+  CheckpointStats c;
+  char delta[100];
+  int kind = ckpt.ref && ckpt.base > - HUGE && !strcmp (name, ckpt.name) &&
+    ckpt.count < checkpoint_full - 1;
+  if (kind) {
+    ckpt.k++, ckpt.count++;
+    sprintf (delta, "%s-delta-%d", name, ckpt.k);
+    c = checkpoint_delta (delta);
+  }
+  else {
+    dump (file = name);
+    for (int k = 1; ; k++) {
+      sprintf (delta, "%s-delta-%d", name, k);
+      if (remove (delta))
+	break;
+    }
+    struct stat st;
+    ckpt.full = stat (name, &st) ? 0 : st.st_size;
+    ckpt.base = t, ckpt.k = ckpt.count = 0;
+    strncpy (ckpt.name, name, 79);
+    c = checkpoint_reset();
+    c.bytes = ckpt.full;
+    c.values = c.leaves*list_len (checkpoint_list);
+  }
+  checkpoint_log (kind, c, timer_elapsed (tm));
+#endif
+}
+
+/**
+## Restoring
+
+The leaf cells of the current tree, with their level, their indices
+and the values of the fields of a delta. */
+
+typedef struct {
+  int level, i, j;
+} CheckpointCell;
+
+static bool checkpoint_apply (const char * name)
+{
+  FILE * fp = fopen (name, "r");
+  if (!fp)
+    return false;
+  CheckpointHeader h;
+  if (fread (&h, sizeof(h), 1, fp) != 1 ||
+      strncmp (h.magic, CHECKPOINT_MAGIC, 8) || h.version != 1 ||
+      h.base != ckpt.base || h.k != ckpt.k + 1 ||
+      h.nf < 1 || h.nf > CHECKPOINT_MAXFIELDS) {
+    fclose (fp);
+    return false;
+  }
+  int nf = h.nf;
+  scalar fields[nf];
+  for (int k = 0; k < nf; k++) {
+    char field[64];
+    if (fread (field, 1, 64, fp) != 64 ||
+	(fields[k] = lookup_field (field)).i < 0) {
+      fprintf (ferr, "checkpoint: %s: unknown field\n", name);
+      fclose (fp);
+      return false;
+    }
+  }
+  double tol[nf];
+  if (fread (tol, sizeof(double), nf, fp) != nf) {
+    fclose (fp);
+    return false;
+  }
+
+  long n = 0;
+  foreach_cell()
+    if (is_leaf (cell)) {
+      n++;
+      continue;
+    }
+  CheckpointCell * old = malloc (max (n, 1)*sizeof(CheckpointCell));
+  double * val = malloc (max (n, 1)*nf*sizeof(double));
+  n = 0;
+  foreach_cell()
+    if (is_leaf (cell)) {
+      old[n] = (CheckpointCell){level, point.i, point.j};
+      for (int k = 0; k < nf; k++) {
+	scalar s = fields[k];
+	val[n*nf + k] = s[];
+      }
+      n++;
+      continue;
+    }
+
+  /**
+  The tree is rebuilt as in `restore()`. Both trees are traversed in
+  the same order, so that the previous cell of an unchanged leaf is
+  found by going forward in the list of the previous leaf cells. */
+
+  init_grid (1);
+  foreach_cell() {
+    cell.pid = pid();
+    cell.flags |= active;
+  }
+  tree->dirty = true;
+  scalar * listm = is_constant(cm) ? NULL : (scalar *){cm, fm};
+  long o = 0;
+  bool ok = true;
+  foreach_cell() {
+    int c = ok ? fgetc (fp) : EOF;
+    if (c == EOF)
+      ok = false;
+    if (!ok)
+      continue;
+    if (!(c & 1)) {
+      if (is_leaf (cell))
+	refine_cell (point, listm, 0, NULL);
+    }
+    else {
+      uint32_t mask = c & 4 ? ~0u : 0;
+      if ((c & 2) && fread (&mask, sizeof(uint32_t), 1, fp) != 1)
+	ok = false;
+      if (ok && !(c & 4)) {
+	while (o < n && (old[o].level != level || old[o].i != point.i ||
+			 old[o].j != point.j))
+	  o++;
+	ok = o < n;
+      }
+      for (int k = 0; k < nf && ok; k++) {
+	scalar s = fields[k];
+	double v;
+	if (!(mask & (1u << k)))
+	  v = val[o*nf + k];
+	else if (fread (&v, sizeof(double), 1, fp) != 1)
+	  ok = false;
+	s[] = v;
+      }
+      continue;
+    }
+  }
+  free (old);
+  free (val);
+  fclose (fp);
+  if (!ok) {
+    fprintf (ferr, "checkpoint: %s is corrupt\n", name);
+    exit (1);
+  }
+
+  /**
+  The other fields are reset. */
+
+  foreach()
+    for (scalar s in all) {
+      bool keep = (s.i == cm.i);
+      foreach_dimension()
+	keep = keep || s.i == fm.x.i;
+      for (int k = 0; k < nf; k++)
+	keep = keep || s.i == fields[k].i;
+      if (!keep)
+	s[] = 0.;
+    }
+  foreach() {
+#if AXI
+    ref_stress_set (point, tau_p.x.x[], tau_p.x.y[], tau_p.y.y[], tau_qq[]);
+#else
+    ref_stress_set (point, tau_p.x.x[], tau_p.x.y[], tau_p.y.y[], 0.);
+#endif
+  }
+  boundary (all);
+
+  /**
+  The face velocity is recomputed as in the `init` event of
+  [centered.h](http://basilisk.fr/src/navier-stokes/centered.h), which
+  does not run again since `i` is restored. */
+
+  foreach_face()
+    uf.x[] = fm.x[]*face_value (u.x, 0);
+  t = h.t, i = h.i;
+  ckpt.k++;
+  return true;
+}
+
+bool checkpoint_restore (const char * name)
+{
+  timer tm = timer_start();
+  if (!restore (file = name))
+    return false;
+  double tfull = timer_elapsed (tm);
+#if !_MPI
+  ckpt.base = t, ckpt.k = 0;
+  strncpy (ckpt.name, name, 79);
+  struct stat st;
+  ckpt.full = stat (name, &st) ? 0 : st.st_size;
+  char delta[100];
+  sprintf (delta, "%s-delta-%d", name, ckpt.k + 1);
+  while (checkpoint_apply (delta))
+    sprintf (delta, "%s-delta-%d", name, ckpt.k + 1);
+  ckpt.count = ckpt.k;
+  CheckpointStats c = checkpoint_reset();
+  fprintf (ferr, "# checkpoint: %s restored in %g s, %d delta(s) in %g s, "
+	   "t = %g, %ld cells\n", name, tfull, ckpt.k,
+	   timer_elapsed (tm) - tfull, t, c.cells);
+#endif
+  return true;
+}
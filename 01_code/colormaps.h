@@ -0,0 +1,33 @@
+/**
+# Colour maps
+
+The fixed colour maps of the figures and movies (`hot` and `RdBu` of
+matplotlib). They have the signature of the colour maps of
+[output.h](http://basilisk.fr/src/output.h), so they can be used with
+`colormap_color()` and `output_ppm()` as well. */
+
+void hot (double cmap[NCMAP][3])
+{
+  for (int i = 0; i < NCMAP; i++) {
+    double t = i/(NCMAP - 1.);
+    cmap[i][0] = clamp (3.*t, 0., 1.);
+    cmap[i][1] = clamp (3.*t - 1., 0., 1.);
+    cmap[i][2] = clamp (3.*t - 2., 0., 1.);
+  }
+}
+
+void rdbu (double cmap[NCMAP][3])
+{
+  static const unsigned char c[11][3] = {
+    {103,0,31}, {178,24,43}, {214,96,77}, {244,165,130}, {253,219,199},
+    {247,247,247}, {209,229,240}, {146,197,222}, {67,147,195},
+    {33,102,172}, {5,48,97}
+  };
+  for (int i = 0; i < NCMAP; i++) {
+    double t = 10.*i/(NCMAP - 1.);
+    int k = min ((int) t, 9);
+    t -= k;
+    for (int j = 0; j < 3; j++)
+      cmap[i][j] = ((1. - t)*c[k][j] + t*c[k + 1][j])/255.;
+  }
+}
@@ -0,0 +1,55 @@
+"""
+Compares two sets of reports written by the benchmark mode of
+burst_evp.c (see benchmark.h and run-benchmarks.sh):
+
+    python3 compare-benchmarks.py bench/<before> bench/<after>
+
+For each preset found in both directories, prints the time per step,
+the cell updates per second, the peak memory and the output volume,
+and the time per step of the events which changed the most.
+"""
+import glob
+import json
+import os
+import sys
+
+
+def load(directory):
+    reports = {}
+    for path in glob.glob(os.path.join(directory, 'benchmark-*.json')):
+        with open(path) as fp:
+            r = json.load(fp)
+        reports[r['preset']] = r
+    return reports
+
+
+def ratio(a, b):
+    return b/a if a > 0 else float('nan')
+
+
+def main(before, after, nevents=8):
+    a, b = load(before), load(after)
+    for preset in sorted(set(a) & set(b)):
+        ra, rb = a[preset], b[preset]
+        print(f"{preset}: {ra['build']} -> {rb['build']}, "
+              f"{ra['threads']} -> {rb['threads']} threads, "
+              f"{ra['steps']} -> {rb['steps']} steps")
+        for key, unit in [('time_per_step', 's'),
+                          ('cell_updates_per_second', '/s'),
+                          ('peak_rss_kb', 'kB'), ('output_bytes', 'B')]:
+            print(f"  {key:24s} {ra[key]:12.4g} {rb[key]:12.4g} {unit:3s}"
+                  f"  x{ratio(ra[key], rb[key]):.3f}")
+        events = set(ra['events']) | set(rb['events'])
+        delta = []
+        for e in events:
+            ta = ra['events'].get(e, {}).get('time_per_step', 0.)
+            tb = rb['events'].get(e, {}).get('time_per_step', 0.)
+            delta.append((abs(tb - ta), e, ta, tb))
+        for _, e, ta, tb in sorted(delta, reverse=True)[:nevents]:
+            print(f"  event {e:18s} {ta:12.4g} {tb:12.4g} s    x{ratio(ta, tb):.3f}")
+
+
+if __name__ == '__main__':
+    if len(sys.argv) != 3:
+        sys.exit(__doc__)
+    main(sys.argv[1], sys.argv[2])
@@ -0,0 +1,549 @@
+/**
+# Comparison of two snapshots
+
+Checks the numerical drift between two builds: reads two snapshots
+(Basilisk dumps, e.g. `intermediate/snapshot-<t>` of both runs) and
+writes, for each field they have in common,
+
+~~~
+field L1 L2 Linf x y max
+~~~
+
+the volume-averaged norms of the difference $b - a$, the position of
+its largest value and the largest $|a|$ (to judge the relative size),
+then one line for the interface ($f = 1/2$) and one for the yield
+surface (boundary of the yielded liquid, `solidreg > 0` and $f >
+1/2$)
+
+~~~
+surface mismatch area_a area_b displacement
+~~~
+
+with the volume between the two surfaces ($\int |f_b - f_a| dV$, or
+the same with the indicator of the yielded liquid), their areas and
+the mean displacement, the mismatch divided by the mean area. The
+volumes and areas use the metric `cm` of the dumps when there is one
+(axisymmetric runs, so without the factor $2\pi$).
+
+~~~bash
+gcc -O2 -Wall compare-snapshots.c -o compare-snapshots -pthread -lm
+./compare-snapshots [-c] [-j threads] [-f f,u.x,...] a/intermediate/snapshot-0.5000 b/intermediate/snapshot-0.5000
+~~~
+
+The two adaptive trees are traversed together, in the order in which
+`dump()` writes the cells. Where one of them is refined further, the
+leaf cell of the coarser one is compared with each cell of the finer
+one (projection onto the finer tree, piecewise constant), or with `-c`
+with their volume average (comparison on the common refinement of the
+two trees). Each cell is read once and only the cells of one branch of
+the trees are held at a time, so the memory does not depend on the
+size of the snapshots. The subtree sizes stored in the dumps give the
+offset of each branch: the branches below level 4 are compared by
+`threads` threads (all the cores by default), each with its own
+buffered reader.
+
+The area of the interface is estimated from the interfacial cells of
+each tree (a length $\pi \Delta/4$ per cell, the mean length of a
+straight line across a cell) and that of the yield surface from the
+faces between neighbouring leaf cells with different indicators (faces
+within a group of four siblings, twice that for the others, and a
+factor $\pi/4$ for the mean orientation). The displacements are thus
+estimates, within some tens of percent; the mismatch volumes are
+exact. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <pthread.h>
+
+#define DUMP_VERSION 170901
+#define DUMP_LEAF 2       // flag of a leaf cell (tree.h)
+#define SPLIT_LEVEL 4     // level of the branches given to the threads
+#define BUFFER (1 << 20)
+
+/**
+## Reading the dumps
+
+The header, the field names and the origin written by `dump()`
+([output.h](http://basilisk.fr/src/output.h)), then one record per
+cell, with its flags and the value of each field. */
+
+typedef struct {
+  double t;
+  long len;
+  int i, depth, npe, version;
+  double n[3];
+} DumpHeader;
+
+typedef struct {
+  const char * path;
+  int fd;
+  DumpHeader h;
+  char ** names;
+  double X0, Y0, L0;
+  long start, rec;        // offset of the root cell, bytes per cell
+  int size, cm, f, yield; // index of these fields, -1 if absent
+} Dump;
+
+static int dump_field (const Dump * d, const char * name)
+{
+  for (int k = 0; k < d->h.len; k++)
+    if (!strcmp (d->names[k], name))
+      return k;
+  return -1;
+}
+
+static bool dump_open (Dump * d, const char * path)
+{
+  d->path = path;
+  FILE * fp = fopen (path, "r");
+  if (!fp) {
+    perror (path);
+    return false;
+  }
+  if (fread (&d->h, sizeof(DumpHeader), 1, fp) < 1 ||
+      d->h.version != DUMP_VERSION || d->h.len < 1 || d->h.len > 1000) {
+    fprintf (stderr, "%s: not a dump (version %d)\n", path, DUMP_VERSION);
+    fclose (fp);
+    return false;
+  }
+  d->names = malloc (d->h.len*sizeof(char *));
+  for (int k = 0; k < d->h.len; k++) {
+    unsigned len;
+    if (fread (&len, sizeof(unsigned), 1, fp) < 1 || len > 1000) {
+      fprintf (stderr, "%s: truncated header\n", path);
+      fclose (fp);
+      return false;
+    }
+    d->names[k] = calloc (len + 1, 1);
+    if (fread (d->names[k], 1, len, fp) < len) {
+      fprintf (stderr, "%s: truncated header\n", path);
+      fclose (fp);
+      return false;
+    }
+  }
+  double o[4];
+  if (fread (o, sizeof(double), 4, fp) < 4) {
+    fprintf (stderr, "%s: truncated header\n", path);
+    fclose (fp);
+    return false;
+  }
+  d->X0 = o[0], d->Y0 = o[1], d->L0 = o[3];
+  d->start = ftell (fp);
+  d->rec = sizeof(unsigned) + d->h.len*sizeof(double);
+  fclose (fp);
+  d->fd = open (path, O_RDONLY);
+  d->size = dump_field (d, "size"), d->cm = dump_field (d, "cm");
+  d->f = dump_field (d, "f"), d->yield = dump_field (d, "solidreg");
+  return d->fd >= 0;
+}
+
+/**
+Each thread reads the cells of its branches through its own buffer,
+with `pread()` so that the threads share the file descriptors. A record
+holds the values of the fields and, after them, the indicator of the
+yielded liquid. */
+
+typedef struct {
+  const Dump * d;
+  char * buf;
+  long offset, pos, end;
+  long bytes;
+} Stream;
+
+static void stream_seek (Stream * s, long offset)
+{
+  s->offset = offset, s->pos = s->end = 0;
+}
+
+static double yielded (const Dump * d, const double * v)
+{
+  return d->yield >= 0 && d->f >= 0 && v[d->yield] > 0. && v[d->f] > 0.5;
+}
+
+static bool stream_record (Stream * s, double * v)
+{
+  if (s->end - s->pos < s->d->rec) {
+    memmove (s->buf, s->buf + s->pos, s->end - s->pos);
+    s->end -= s->pos, s->pos = 0;
+    ssize_t n = pread (s->d->fd, s->buf + s->end, BUFFER - s->end, s->offset);
+    if (n > 0)
+      s->end += n, s->offset += n, s->bytes += n;
+    if (s->end < s->d->rec) {
+      fprintf (stderr, "%s: truncated\n", s->d->path);
+      exit (1);
+    }
+  }
+  unsigned flags;
+  memcpy (&flags, s->buf + s->pos, sizeof(unsigned));
+  memcpy (v, s->buf + s->pos + sizeof(unsigned), s->d->h.len*sizeof(double));
+  s->pos += s->d->rec;
+  v[s->d->h.len] = yielded (s->d, v);
+  return flags & DUMP_LEAF;
+}
+
+static bool record_at (const Dump * d, long offset, double * v)
+{
+  char buf[d->rec];
+  if (pread (d->fd, buf, d->rec, offset) != d->rec) {
+    fprintf (stderr, "%s: truncated\n", d->path);
+    exit (1);
+  }
+  unsigned flags;
+  memcpy (&flags, buf, sizeof(unsigned));
+  memcpy (v, buf + sizeof(unsigned), d->h.len*sizeof(double));
+  return flags & DUMP_LEAF;
+}
+
+/**
+## Comparison
+
+The sums of each thread, added together at the end. Index 0 is
+snapshot $a$, index 1 snapshot $b$. */
+
+typedef struct {
+  int n;                     // fields compared
+  double volume;
+  long cells;
+  double * l1, * l2, * linf, * x, * y, * max;
+  double mismatch[2], area[2][2]; // interface, yield surface
+} Sums;
+
+static void sums_init (Sums * s, int n)
+{
+  memset (s, 0, sizeof(Sums));
+  s->n = n;
+  s->l1 = calloc (6*n, sizeof(double));
+  s->l2 = s->l1 + n, s->linf = s->l2 + n, s->x = s->linf + n;
+  s->y = s->x + n, s->max = s->y + n;
+}
+
+static void sums_add (Sums * s, const Sums * b)
+{
+  s->volume += b->volume, s->cells += b->cells;
+  for (int k = 0; k < s->n; k++) {
+    s->l1[k] += b->l1[k], s->l2[k] += b->l2[k];
+    if (b->linf[k] > s->linf[k])
+      s->linf[k] = b->linf[k], s->x[k] = b->x[k], s->y[k] = b->y[k];
+    if (b->max[k] > s->max[k])
+      s->max[k] = b->max[k];
+  }
+  for (int j = 0; j < 2; j++) {
+    s->mismatch[j] += b->mismatch[j];
+    s->area[j][0] += b->area[j][0], s->area[j][1] += b->area[j][1];
+  }
+}
+
+typedef struct {
+  const Dump * d[2];
+  int (* map)[2];            // index of each compared field in a and b
+  bool common;
+  Stream s[2];
+  Sums sums;
+} Work;
+
+/**
+What the parent needs from each of its children: whether it is a leaf
+of each tree, its volume and its indicator of the yielded liquid. */
+
+typedef struct {
+  bool leaf[2];
+  double dv[2], y[2];
+} Cell;
+
+/**
+Sums of the values of the cells of one tree below a leaf of the
+other, for the comparison on the common refinement. */
+
+typedef struct {
+  double * v, dv;
+} Average;
+
+static double cell_volume (const Dump * d, const double * v, double delta)
+{
+  return (d->cm >= 0 ? v[d->cm] : 1.)*delta*delta;
+}
+
+static void compare (Work * w, const double * a, const double * b, double dv,
+		     int level, int i, int j)
+{
+  Sums * s = &w->sums;
+  double delta = w->d[0]->L0/(1L << level);
+  s->volume += dv, s->cells++;
+  for (int k = 0; k < s->n; k++) {
+    double va = a[w->map[k][0]], e = fabs (b[w->map[k][1]] - va);
+    s->l1[k] += e*dv, s->l2[k] += e*e*dv;
+    if (e > s->linf[k]) {
+      s->linf[k] = e;
+      s->x[k] = w->d[0]->X0 + (i + 0.5)*delta;
+      s->y[k] = w->d[0]->Y0 + (j + 0.5)*delta;
+    }
+    if (fabs (va) > s->max[k])
+      s->max[k] = fabs (va);
+  }
+  if (w->d[0]->f >= 0 && w->d[1]->f >= 0)
+    s->mismatch[0] += fabs (b[w->d[1]->f] - a[w->d[0]->f])*dv;
+  s->mismatch[1] += fabs (b[w->d[1]->h.len] - a[w->d[0]->h.len])*dv;
+}
+
+/**
+One cell of the merged traversal. `held[t]` is the record of a leaf
+of tree $t$ above this cell, in which case the cell is only in the
+other tree; otherwise the record of the cell is read from the stream
+of tree $t$. */
+
+static void node (Work * w, const double * held[2], Average * avg,
+		  int level, int i, int j, Cell * out)
+{
+  double delta = w->d[0]->L0/(1L << level);
+  double v0[w->d[0]->h.len + 1], v1[w->d[1]->h.len + 1];
+  double * v[2] = {v0, v1};
+  bool terminal[2];
+  for (int t = 0; t < 2; t++) {
+    out->leaf[t] = false;
+    if (held[t])
+      terminal[t] = true;
+    else {
+      const Dump * d = w->d[t];
+      terminal[t] = out->leaf[t] = stream_record (&w->s[t], v[t]);
+      out->dv[t] = cell_volume (d, v[t], delta);
+      out->y[t] = v[t][d->h.len];
+      if (out->leaf[t] && d->f >= 0 && v[t][d->f] > 1e-6 && v[t][d->f] < 1. - 1e-6)
+	w->sums.area[0][t] += M_PI/4.*out->dv[t]/delta;
+    }
+  }
+  const double * a = held[0] ? held[0] : v0, * b = held[1] ? held[1] : v1;
+
+  if (terminal[0] && terminal[1]) {
+    double dv = held[1] ? out->dv[0] : out->dv[1];
+    if (avg) {
+      const double * c = held[0] ? b : a;
+      int n = w->d[held[0] ? 1 : 0]->h.len + 1;
+      for (int k = 0; k < n; k++)
+	avg->v[k] += c[k]*dv;
+      avg->dv += dv;
+    }
+    else
+      compare (w, a, b, dv, level, i, j);
+    return;
+  }
+
+  /**
+  Below a leaf of one tree, the other tree is either compared cell by
+  cell, or averaged and compared with the leaf. */
+
+  const double * h[2] = {terminal[0] ? a : NULL, terminal[1] ? b : NULL};
+  Average sub = {NULL, 0.}, * below = avg;
+  if (w->common && !avg && (terminal[0] || terminal[1])) {
+    int n = w->d[terminal[0] ? 1 : 0]->h.len + 1;
+    sub.v = calloc (n, sizeof(double));
+    below = &sub;
+  }
+  Cell c[4];
+  for (int k = 0; k < 4; k++)
+    node (w, h, below, level + 1, 2*i + k/2, 2*j + k%2, &c[k]);
+  if (sub.v) {
+    int n = w->d[terminal[0] ? 1 : 0]->h.len + 1;
+    for (int k = 0; k < n; k++)
+      sub.v[k] /= sub.dv;
+    if (terminal[0])
+      compare (w, a, sub.v, sub.dv, level, i, j);
+    else
+      compare (w, sub.v, b, sub.dv, level, i, j);
+    free (sub.v);
+  }
+
+  /**
+  Faces between sibling leaf cells, for the area of the yield
+  surface: $(0,0)-(1,0)$, $(0,1)-(1,1)$, $(0,0)-(0,1)$ and
+  $(1,0)-(1,1)$. */
+
+  static const int face[4][2] = {{0, 2}, {1, 3}, {0, 1}, {2, 3}};
+  for (int t = 0; t < 2; t++)
+    for (int k = 0; k < 4; k++) {
+      Cell * p = &c[face[k][0]], * q = &c[face[k][1]];
+      if (p->leaf[t] && q->leaf[t])
+	w->sums.area[1][t] += M_PI/2.*fabs (p->y[t] - q->y[t])*
+	  (p->dv[t] + q->dv[t])/delta;
+    }
+}
+
+/**
+## Branches
+
+The branches below `SPLIT_LEVEL` (or below a leaf of one of the trees
+above it) are listed first, from the subtree sizes. */
+
+typedef struct {
+  long offset[2];
+  int level, i, j;
+} Branch;
+
+typedef struct {
+  Branch * b;
+  int n, max;
+} Branches;
+
+static long skip (const Dump * d, long offset)
+{
+  double v[d->h.len + 1];
+  record_at (d, offset, v);
+  return offset + (long) v[d->size]*d->rec;
+}
+
+static void branches (const Dump * d[2], Branches * l, long offset[2],
+		      int level, int i, int j, int split)
+{
+  double v0[d[0]->h.len + 1], v1[d[1]->h.len + 1];
+  bool leaf = record_at (d[0], offset[0], v0) | record_at (d[1], offset[1], v1);
+  if (level >= split || leaf) {
+    if (l->n == l->max)
+      l->b = realloc (l->b, (l->max = 2*l->max + 16)*sizeof(Branch));
+    l->b[l->n++] = (Branch){{offset[0], offset[1]}, level, i, j};
+    return;
+  }
+  long child[2] = {offset[0] + d[0]->rec, offset[1] + d[1]->rec};
+  for (int k = 0; k < 4; k++) {
+    branches (d, l, child, level + 1, 2*i + k/2, 2*j + k%2, split);
+    child[0] = skip (d[0], child[0]), child[1] = skip (d[1], child[1]);
+  }
+}
+
+typedef struct {
+  Work * w;
+  Branches * l;
+  int * next;
+} Thread;
+
+static void * worker (void * p)
+{
+  Thread * th = p;
+  Work * w = th->w;
+  for (int t = 0; t < 2; t++)
+    w->s[t].buf = malloc (BUFFER);
+  int k;
+  while ((k = __atomic_fetch_add (th->next, 1, __ATOMIC_RELAXED)) < th->l->n) {
+    Branch * b = &th->l->b[k];
+    stream_seek (&w->s[0], b->offset[0]), stream_seek (&w->s[1], b->offset[1]);
+    const double * held[2] = {NULL, NULL};
+    Cell c;
+    node (w, held, NULL, b->level, b->i, b->j, &c);
+  }
+  free (w->s[0].buf), free (w->s[1].buf);
+  return NULL;
+}
+
+static double wall()
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+int main (int argc, char * argv[])
+{
+  int threads = sysconf (_SC_NPROCESSORS_ONLN), opt;
+  bool common = false;
+  char * fields = NULL;
+  while ((opt = getopt (argc, argv, "cj:f:")) != -1)
+    switch (opt) {
+    case 'c': common = true; break;
+    case 'j': threads = atoi (optarg); break;
+    case 'f': fields = optarg; break;
+    default:
+      fprintf (stderr, "usage: %s [-c] [-j threads] [-f fields] a b\n", argv[0]);
+      return 1;
+    }
+  if (argc - optind != 2) {
+    fprintf (stderr, "usage: %s [-c] [-j threads] [-f fields] a b\n", argv[0]);
+    return 1;
+  }
+  Dump da, db;
+  if (!dump_open (&da, argv[optind]) || !dump_open (&db, argv[optind + 1]))
+    return 1;
+  if (da.L0 != db.L0 || da.X0 != db.X0 || da.Y0 != db.Y0) {
+    fprintf (stderr, "%s and %s: different domains\n", da.path, db.path);
+    return 1;
+  }
+  const Dump * d[2] = {&da, &db};
+
+  /**
+  The fields of both snapshots (or those of `-f`), except the subtree
+  size and the metric. */
+
+  int (* map)[2] = malloc (da.h.len*sizeof(int[2])), n = 0;
+  for (int k = 0; k < da.h.len; k++) {
+    int kb = dump_field (&db, da.names[k]);
+    if (k == da.size || k == da.cm)
+      continue;
+    if (fields) {
+      char list[strlen (fields) + 3];
+      sprintf (list, ",%s,", fields);
+      char name[strlen (da.names[k]) + 3];
+      sprintf (name, ",%s,", da.names[k]);
+      if (!strstr (list, name))
+	continue;
+    }
+    if (kb < 0)
+      fprintf (stderr, "%s: no field %s\n", db.path, da.names[k]);
+    else
+      map[n][0] = k, map[n][1] = kb, n++;
+  }
+
+  double start = wall();
+  Branches l = {NULL, 0, 0};
+  long offset[2] = {da.start, db.start};
+  if (da.size < 0 || db.size < 0)
+    threads = 1;
+  branches (d, &l, offset, 0, 0, 0, threads > 1 ? SPLIT_LEVEL : 0);
+  if (threads > l.n)
+    threads = l.n;
+
+  Work work[threads];
+  Thread th[threads];
+  pthread_t id[threads];
+  int next = 0;
+  for (int k = 0; k < threads; k++) {
+    memset (&work[k], 0, sizeof(Work));
+    work[k].d[0] = work[k].s[0].d = &da, work[k].d[1] = work[k].s[1].d = &db;
+    work[k].map = map, work[k].common = common;
+    sums_init (&work[k].sums, n);
+    th[k] = (Thread){&work[k], &l, &next};
+    pthread_create (&id[k], NULL, worker, &th[k]);
+  }
+  Sums s;
+  sums_init (&s, n);
+  long bytes = 0;
+  for (int k = 0; k < threads; k++) {
+    pthread_join (id[k], NULL);
+    sums_add (&s, &work[k].sums);
+    bytes += work[k].s[0].bytes + work[k].s[1].bytes;
+  }
+  double elapsed = wall() - start;
+
+  printf ("# a: %s, t = %g, depth %d\n# b: %s, t = %g, depth %d\n",
+	  da.path, da.h.t, da.h.depth, db.path, db.h.t, db.h.depth);
+  printf ("# %s, %ld cells compared, %d threads, %d branches, "
+	  "%.3g s, %.3g MB/s\n", common ? "common refinement" : "finer tree",
+	  s.cells, threads, l.n, elapsed, bytes/elapsed/1e6);
+  printf ("field L1 L2 Linf x y max\n");
+  for (int k = 0; k < n; k++)
+    printf ("%s %g %g %g %g %g %g\n", da.names[map[k][0]],
+	    s.l1[k]/s.volume, sqrt (s.l2[k]/s.volume), s.linf[k],
+	    s.x[k], s.y[k], s.max[k]);
+  printf ("surface mismatch area_a area_b displacement\n");
+  const char * surface[2] = {"interface", "yield"};
+  for (int j = 0; j < 2; j++) {
+    double area = (s.area[j][0] + s.area[j][1])/2.;
+    printf ("%s %g %g %g %g\n", surface[j], s.mismatch[j], s.area[j][0],
+	    s.area[j][1], area > 0. ? s.mismatch[j]/area : 0.);
+  }
+  return 0;
+}
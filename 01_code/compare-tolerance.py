@@ -0,0 +1,88 @@
+"""
+Compares a run with the fixed solver tolerance and a run with the
+adaptive tolerance of adaptive-tolerance.h (see tolerance-study.sh):
+
+    python3 compare-tolerance.py <fixed> <adaptive>
+
+Prints the multigrid work and iterations of both runs, the differences
+of the kinetic-energy and jet-velocity histories (the adaptive run is
+interpolated at the steps of the fixed run, over their common time
+interval), the peak jet velocity and the milestone times.
+"""
+import bisect
+import os
+import sys
+
+
+def load_table(path):
+    with open(path) as fp:
+        header = fp.readline().split()
+        rows = [line.split() for line in fp if line.strip()]
+    return header, rows
+
+
+def load_solver(directory):
+    header, rows = load_table(os.path.join(directory, 'solver'))
+    return {k: [float(r[j]) for r in rows] for j, k in enumerate(header)}
+
+
+def load_milestones(directory):
+    path = os.path.join(directory, 'milestones')
+    if not os.path.exists(path):
+        return {}
+    _, rows = load_table(path)
+    return {r[1]: float(r[0]) for r in rows}
+
+
+def interpolate(t, x, s):
+    k = bisect.bisect_left(t, s)
+    if k == 0:
+        return x[0]
+    if k == len(t):
+        return x[-1]
+    w = (s - t[k - 1])/(t[k] - t[k - 1]) if t[k] > t[k - 1] else 1.
+    return x[k - 1] + w*(x[k] - x[k - 1])
+
+
+def history_error(a, b, key):
+    """Largest and rms difference of b[key] and a[key], relative to the
+    largest |a[key]|, over the common time interval."""
+    tmax = min(a['t'][-1], b['t'][-1])
+    diff = [abs(interpolate(b['t'], b[key], s) - x)
+            for s, x in zip(a['t'], a[key]) if s <= tmax]
+    scale = max(abs(x) for x in a[key]) or 1.
+    rms = (sum(d*d for d in diff)/len(diff))**0.5 if diff else 0.
+    return max(diff, default=0.)/scale, rms/scale
+
+
+def main(fixed, adaptive):
+    a, b = load_solver(fixed), load_solver(adaptive)
+    print(f"{'':24s} {'fixed':>12s} {'adaptive':>12s}")
+    for key, label in [('work', 'work (iter x cells)'),
+                       ('ip', 'projection iterations'),
+                       ('iu', 'viscous iterations')]:
+        sa, sb = sum(a[key]), sum(b[key])
+        print(f"{label:24s} {sa:12.4g} {sb:12.4g}"
+              f"  saved {100.*(1. - sb/sa) if sa > 0 else 0.:.1f}%")
+    print(f"{'steps':24s} {len(a['i']):12d} {len(b['i']):12d}")
+    print(f"{'active steps':24s} {int(sum(a['active'])):12d} "
+          f"{int(sum(b['active'])):12d}")
+    print(f"{'end time':24s} {a['t'][-1]:12.4g} {b['t'][-1]:12.4g}")
+    for key in ['ke', 'vjet']:
+        emax, erms = history_error(a, b, key)
+        print(f"{key + ' history':24s} max {emax:10.3g} rms {erms:10.3g}"
+              f" (relative to the largest fixed value)")
+    for run, name in [(a, 'fixed'), (b, 'adaptive')]:
+        k = max(range(len(run['vjet'])), key=lambda j: run['vjet'][j])
+        print(f"peak vjet {name:14s} {run['vjet'][k]:12.5g} at t = {run['t'][k]:.4g}")
+    ma, mb = load_milestones(fixed), load_milestones(adaptive)
+    for m in ['collapse', 'jet', 'pinch', 'rest', 'stop']:
+        if m in ma or m in mb:
+            print(f"milestone {m:14s} {ma.get(m, float('nan')):12.5g} "
+                  f"{mb.get(m, float('nan')):12.5g}")
+
+
+if __name__ == '__main__':
+    if len(sys.argv) != 3:
+        sys.exit(__doc__)
+    main(sys.argv[1], sys.argv[2])
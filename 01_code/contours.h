@@ -0,0 +1,332 @@
+/**
+# Interface and yield-surface contours
+
+The interface (the VOF facets of $f$) and the yield surface (the
+boundary of the yielded liquid, `solidreg > 0` and $f > 1/2$) are
+extracted as ordered polylines:
+
+1. `interface_segments()` and `yield_segments()` collect one segment per
+   cut leaf cell. The leaf cells are processed in parallel and each
+   thread appends to its own buffer.
+2. `segments_chain()` joins the segments whose ends are closer than
+   half the size of their cell. Neighbouring PLIC facets do not share
+   their ends exactly, so joined ends are replaced by their midpoint.
+   The result is a set of open or closed polylines.
+
+With `-DCONTOURS=1`, every `contour_dt` both sets of polylines are
+written to `intermediate/contours-<t>` (read with
+[contours.py](../04_graphical_abstract/contours.py)), so that the
+boundaries can be traced without keeping full dumps. The format is
+
+~~~
+char[8]    magic "EVPCONT1"
+double     t
+int32      number of surfaces (2: "interface", "yield")
+for each surface:
+  char[16]   name
+  int32      number of polylines n
+  int32[n]   number of points of each polyline (negative if closed)
+  float32[][2]  points (x, y) of all the polylines
+~~~
+*/
+
+#include "fractions.h"
+
+typedef struct {
+  coord * p;      // 2 points per segment
+  double * d;     // size of the cell of each segment
+  int n, nmax;    // number of segments, allocated size
+} Segments;
+
+typedef struct {
+  coord * p;      // points of all the polylines
+  int np, npmax;
+  int * start;    // polyline k is p[start[k]] ... p[start[k+1] - 1]
+  bool * closed;
+  int n, nmax;    // number of polylines, allocated size
+} Polylines;
+
+static void segments_add (Segments * s, coord a, coord b, double d)
+{
+  if (s->n == s->nmax) {
+    s->nmax = s->nmax ? 2*s->nmax : 1024;
+    s->p = qrealloc (s->p, 2*s->nmax, coord);
+    s->d = qrealloc (s->d, s->nmax, double);
+  }
+  s->p[2*s->n] = a, s->p[2*s->n + 1] = b;
+  s->d[s->n++] = d;
+}
+
+void segments_free (Segments * s)
+{
+  free (s->p), free (s->d);
+  *s = (Segments){0};
+}
+
+void polylines_free (Polylines * l)
+{
+  free (l->p), free (l->start), free (l->closed);
+  *l = (Polylines){0};
+}
+
+/**
+## Segments
+
+The facets of the volume fraction `c`, with the face fractions `fs`
+if they are known (i.e. when `c` has been computed by `fractions()`).
+Each thread (`pid()`) fills its own buffer; the buffers are then
+concatenated. */
+
+#if _OPENMP
+# define contour_nthreads() omp_get_max_threads() // npe() is 1 out of a parallel region
+#else
+# define contour_nthreads() npe()
+#endif
+
+static Segments facet_segments (scalar c, face vector fs)
+{
+  int nth = contour_nthreads();
+  Segments * ts = qcalloc (nth, Segments);
+  foreach()
+    if (c[] > 1e-6 && c[] < 1. - 1e-6) {
+      coord n = facet_normal (point, c, fs);
+      double alpha = plane_alpha (c[], n);
+      coord q[2];
+      if (facets (n, alpha, q) == 2)
+	segments_add (&ts[pid()],
+		      (coord){x + q[0].x*Delta, y + q[0].y*Delta},
+		      (coord){x + q[1].x*Delta, y + q[1].y*Delta}, Delta);
+    }
+  Segments s = ts[0];
+  for (int k = 1; k < nth; k++) {
+    for (int i = 0; i < ts[k].n; i++)
+      segments_add (&s, ts[k].p[2*i], ts[k].p[2*i + 1], ts[k].d[i]);
+    segments_free (&ts[k]);
+  }
+  free (ts);
+  return s;
+}
+
+Segments interface_segments (scalar c)
+{
+  return facet_segments (c, (face vector){{-1}});
+}
+
+/**
+The yield surface is the zero isoline of a vertex field which is
+positive in the yielded liquid and negative elsewhere. Its segments
+are the facets of the corresponding volume fraction. */
+
+Segments yield_segments (scalar solidreg, scalar c)
+{
+  vertex scalar phi[];
+  foreach_vertex() {
+    double s = 0.;
+    for (int i = -1; i <= 0; i++)
+      for (int j = -1; j <= 0; j++)
+	s += solidreg[i,j] > 0. && c[i,j] > 0.5 ? 1. : -1.;
+    phi[] = s/4.;
+  }
+  scalar ys[];
+  face vector yfs[];
+  fractions (phi, ys, yfs);
+  return facet_segments (ys, yfs);
+}
+
+/**
+## Chaining
+
+The segment ends are sorted by bin of a uniform grid with the size of
+the smallest cell. The partner of an end is the closest free end of
+another segment in the neighbouring bins. */
+
+typedef struct {
+  long key;
+  int e;
+} ContourEnd;
+
+static int contour_end_cmp (const void * a, const void * b)
+{
+  long ka = ((const ContourEnd *) a)->key, kb = ((const ContourEnd *) b)->key;
+  return ka < kb ? -1 : ka > kb;
+}
+
+static void polylines_add (Polylines * l, coord p)
+{
+  if (l->np == l->npmax) {
+    l->npmax = l->npmax ? 2*l->npmax : 1024;
+    l->p = qrealloc (l->p, l->npmax, coord);
+  }
+  l->p[l->np++] = p;
+}
+
+static void polylines_begin (Polylines * l)
+{
+  if (l->n + 1 >= l->nmax) {
+    l->nmax = l->nmax ? 2*l->nmax : 64;
+    l->start = qrealloc (l->start, l->nmax + 1, int);
+    l->closed = qrealloc (l->closed, l->nmax, bool);
+  }
+  l->start[l->n] = l->np;
+  l->closed[l->n] = false;
+}
+
+static void polylines_end (Polylines * l, bool closed)
+{
+  l->closed[l->n++] = closed;
+  l->start[l->n] = l->np;
+}
+
+static coord contour_mid (coord a, coord b)
+{
+  return (coord){(a.x + b.x)/2., (a.y + b.y)/2.};
+}
+
+Polylines segments_chain (const Segments * s)
+{
+  Polylines l = {0};
+  polylines_begin (&l);
+  if (!s->n)
+    return l;
+
+  int ne = 2*s->n;
+  double h = HUGE;
+  for (int k = 0; k < s->n; k++)
+    if (s->d[k] < h)
+      h = s->d[k];
+  long nb = L0/h + 3;
+  ContourEnd * end = qmalloc (ne, ContourEnd);
+  for (int e = 0; e < ne; e++) {
+    long ix = (s->p[e].x - X0)/h + 1, iy = (s->p[e].y - Y0)/h + 1;
+    end[e] = (ContourEnd){ix*nb + iy, e};
+  }
+  qsort (end, ne, sizeof (ContourEnd), contour_end_cmp);
+
+  int * partner = qmalloc (ne, int);
+  for (int e = 0; e < ne; e++)
+    partner[e] = -1;
+  for (int e = 0; e < ne; e++) {
+    if (partner[e] >= 0)
+      continue;
+    double tol = s->d[e/2]/2., best = sq(tol);
+    int r = ceil (tol/h), partner_e = -1;
+    long ix = (s->p[e].x - X0)/h + 1, iy = (s->p[e].y - Y0)/h + 1;
+    for (long i = ix - r; i <= ix + r; i++)
+      for (long j = iy - r; j <= iy + r; j++) {
+	ContourEnd k = {i*nb + j}, * b =
+	  bsearch (&k, end, ne, sizeof (ContourEnd), contour_end_cmp);
+	if (!b)
+	  continue;
+	while (b > end && b[-1].key == k.key)
+	  b--;
+	for (; b < end + ne && b->key == k.key; b++) {
+	  int e2 = b->e;
+	  if (e2/2 == e/2 || partner[e2] >= 0)
+	    continue;
+	  double d2 = sq(s->p[e2].x - s->p[e].x) + sq(s->p[e2].y - s->p[e].y);
+	  if (d2 <= best)
+	    best = d2, partner_e = e2;
+	}
+      }
+    if (partner_e >= 0)
+      partner[e] = partner_e, partner[partner_e] = e;
+  }
+
+  /**
+  The ends have at most one partner, so the segments form open chains
+  (first pass, starting from a free end) and closed loops (second
+  pass). */
+
+  bool * used = qcalloc (s->n, bool);
+  for (int pass = 0; pass < 2; pass++)
+    for (int k = 0; k < s->n; k++) {
+      if (used[k])
+	continue;
+      int e;
+      if (pass == 0) {
+	if (partner[2*k] < 0) e = 2*k;
+	else if (partner[2*k + 1] < 0) e = 2*k + 1;
+	else continue;
+	polylines_add (&l, s->p[e]);
+      }
+      else {
+	e = 2*k;
+	polylines_add (&l, contour_mid (s->p[e], s->p[partner[e]]));
+      }
+      bool closed = false;
+      for (;;) {
+	used[e/2] = true;
+	int o = e ^ 1, q = partner[o];
+	if (q < 0) {
+	  polylines_add (&l, s->p[o]);
+	  break;
+	}
+	if (used[q/2]) {
+	  closed = true;
+	  break;
+	}
+	polylines_add (&l, contour_mid (s->p[o], s->p[q]));
+	e = q;
+      }
+      polylines_end (&l, closed);
+      polylines_begin (&l);
+    }
+
+  free (used), free (partner), free (end);
+  return l;
+}
+
+/**
+## Output */
+
+#define CONTOUR_MAGIC "EVPCONT1"
+
+void contours_write (FILE * fp, Polylines * l, const char ** names, int n)
+{
+  fwrite (CONTOUR_MAGIC, 1, 8, fp);
+  fwrite (&t, sizeof(double), 1, fp);
+  fwrite (&n, sizeof(int), 1, fp);
+  for (int s = 0; s < n; s++) {
+    char name[16] = {0};
+    strncpy (name, names[s], 15);
+    fwrite (name, 1, 16, fp);
+    fwrite (&l[s].n, sizeof(int), 1, fp);
+    for (int k = 0; k < l[s].n; k++) {
+      int np = l[s].start[k + 1] - l[s].start[k];
+      if (l[s].closed[k])
+	np = - np;
+      fwrite (&np, sizeof(int), 1, fp);
+    }
+    for (int i = 0; i < l[s].np; i++) {
+      float xy[2] = {l[s].p[i].x, l[s].p[i].y};
+      fwrite (xy, sizeof(float), 2, fp);
+    }
+  }
+}
+
+/**
+The event is only compiled with `-DCONTOURS=1`: other headers, such as
+[revolve-mesh.h](revolve-mesh.h), use the extraction alone. */
+
+#if CONTOURS
+double contour_dt = 0.005;
+
+event contours (t = 0; t += contour_dt)
+{
+  evp_diagnostics();
+  Segments s[2] = {interface_segments (f), yield_segments (solidreg, f)};
+  Polylines l[2];
+  for (int k = 0; k < 2; k++) {
+    l[k] = segments_chain (&s[k]);
+    segments_free (&s[k]);
+  }
+  const char * names[2] = {"interface", "yield"};
+  char name[80];
+  sprintf (name, "intermediate/contours-%5.4f", t);
+  FILE * fp = fopen (name, "w");
+  contours_write (fp, l, names, 2);
+  fclose (fp);
+  for (int k = 0; k < 2; k++)
+    polylines_free (&l[k]);
+}
+#endif
@@ -0,0 +1,104 @@
+/**
+# Timing of the droplet labelling
+
+Labels a pool and a lattice of axisymmetric droplets of random radii
+(one droplet per lattice cell, so that they never touch) on an adaptive
+tree refined to `maxlevel` around the interfaces, with `droplets_find()` of
+[droplets.h](droplets.h) and with `tag()` of Basilisk's `tag.h`.
+
+Outputs the number of leaf cells, the number of components found by
+each method (which must be the number of droplets plus one), the time
+per call and per cell, and the volume of the droplets compared with
+the exact volume of the tori (the droplets are off the axis).
+
+~~~bash
+qcc -O2 -Wall -disable-dimensions -fopenmp droplets-bench.c -o dbench -lm
+OMP_NUM_THREADS=8 ./dbench 11 20
+OMP_NUM_THREADS=8 ./dbench 13 20
+~~~
+*/
+
+#include "axi.h"
+#include "fractions.h"
+#include "tag.h"
+
+scalar f[];
+vector u[];
+
+#include "droplets.h"
+
+#define NL 14
+#define SPACING 0.25
+double radius[NL][NL];
+
+static double shape (double x, double y)
+{
+  double phi = - x - 0.5; // pool below x = -0.5
+  for (int i = 0; i < NL; i++)
+    for (int j = 0; j < NL; j++) {
+      double xc = (i + 0.5)*SPACING, yc = (j + 0.5)*SPACING;
+      double d = radius[i][j] - sqrt (sq(x - xc) + sq(y - yc));
+      if (d > phi)
+	phi = d;
+    }
+  return phi;
+}
+
+int main (int argc, char * argv[])
+{
+  int maxlevel = argc > 1 ? atoi (argv[1]) : 11;
+  int nrep = argc > 2 ? atoi (argv[2]) : 10;
+
+  L0 = 8.;
+  origin (-L0/2., 0.);
+  init_grid (1 << 6);
+
+  srand (1);
+  double Vexact = 0.;
+  for (int i = 0; i < NL; i++)
+    for (int j = 0; j < NL; j++) {
+      radius[i][j] = 0.02 + 0.08*rand()/(double) RAND_MAX;
+      Vexact += 2.*pi*(j + 0.5)*SPACING*pi*sq(radius[i][j]);
+    }
+
+  refine (fabs (shape (x, y)) < 2.*L0/(1 << level) && level < maxlevel);
+  vertex scalar phi[];
+  foreach_vertex()
+    phi[] = shape (x, y);
+  fractions (phi, f);
+  foreach()
+    u.x[] = x, u.y[] = - y/2.;
+
+  long n = 0;
+  foreach (reduction(+:n))
+    n++;
+
+  DropletList l = droplets_find (f, u, 0.5); // warm-up, builds the leaf view
+  timer tm = timer_start();
+  for (int r = 0; r < nrep; r++) {
+    free (l.d);
+    l = droplets_find (f, u, 0.5);
+  }
+  double s1 = timer_elapsed (tm)/nrep;
+
+  scalar m[];
+  int ntag = 0;
+  tm = timer_start();
+  for (int r = 0; r < nrep; r++) {
+    foreach()
+      m[] = f[] > 0.5;
+    ntag = tag (m);
+  }
+  double s2 = timer_elapsed (tm)/nrep;
+
+  double V = 0.;
+  for (int k = 1; k < l.n; k++)
+    V += l.d[k].V;
+  fprintf (stderr, "%ld leaf cells, %d droplets + pool\n", n, NL*NL);
+  fprintf (stderr, "%-16s %6d components %10.3g s/call %8.3g ns/cell\n",
+	   "droplets_find()", l.n, s1, 1e9*s1/n);
+  fprintf (stderr, "%-16s %6d components %10.3g s/call %8.3g ns/cell\n",
+	   "tag()", ntag, s2, 1e9*s2/n);
+  fprintf (stderr, "droplet volume %g, exact %g\n", V, Vexact);
+  free (l.d);
+}
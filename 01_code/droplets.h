@@ -0,0 +1,230 @@
+/**
+# Droplets
+
+The connected components of the liquid (`c > threshold`) are labelled
+directly on the adaptive tree, in parallel:
+
+1. each leaf cell is numbered with a [LeafView](leaf-soa.h) and the
+   liquid cells start as their own root in a union-find forest,
+2. every liquid cell merges with its liquid neighbours across its top
+   and right faces. A neighbour is either a leaf of the same level, the
+   two children of a refined cell or the coarser leaf which contains
+   it, so components are connected across refinement-level jumps (the
+   tree is 2:1 balanced). Roots are linked with an atomic
+   compare-and-swap, the larger index to the smaller one, so the
+   threads never lock,
+3. the paths are compressed and each root gets a compact number, and
+   the volume ($2\pi y\,\Delta^2 c$), centroid and mean velocity of each
+   component are summed by each thread in its own array.
+
+Components touch through faces only: two liquid cells sharing a
+corner are separate droplets. The liquid of the cells below the
+threshold is not counted.
+
+`droplets_find()` returns the components sorted by decreasing volume;
+the first one is the bulk of the liquid. With `-DDROPLETS=1`, every
+`droplet_dt` they are appended to `droplets`, one line per component:
+
+~~~
+t k V x y ux uy ncells
+~~~
+
+with `k = 0` for the bulk. Otherwise the components are only labelled
+when asked for (e.g. by [milestones.h](milestones.h)). The time spent
+labelling is printed at the end of the run. */
+
+#include "leaf-soa.h"
+
+#ifndef DROPLETS
+# define DROPLETS 0
+#endif
+
+double droplet_dt = 0.005;       // interval between two entries of `droplets`
+double droplet_threshold = 0.5;  // liquid where c > droplet_threshold
+
+typedef struct {
+  double V;       // volume
+  coord c, u;     // centroid and mean velocity
+  int ncells;     // number of leaf cells
+} Droplet;
+
+typedef struct {
+  Droplet * d;    // by decreasing volume
+  int n;
+} DropletList;
+
+static struct {
+  LeafView view;
+  int * parent, * id;
+  int nmax;
+  int ncalls;
+  long ncells;
+  double time;    // accumulated time (s)
+} droplet_state;
+
+/**
+## Union-find
+
+Only roots are modified by `droplet_unite()`; the path halving of
+`droplet_find()` only moves a cell closer to its root, so it can run
+concurrently with the links. */
+
+static inline int droplet_find (int * p, int k)
+{
+  int q;
+  while ((q = __atomic_load_n (&p[k], __ATOMIC_RELAXED)) != k) {
+    int r = __atomic_load_n (&p[q], __ATOMIC_RELAXED);
+    if (r != q)
+      __atomic_store_n (&p[k], r, __ATOMIC_RELAXED);
+    k = q;
+  }
+  return k;
+}
+
+static inline void droplet_unite (int * p, int a, int b)
+{
+  for (;;) {
+    a = droplet_find (p, a), b = droplet_find (p, b);
+    if (a == b)
+      return;
+    if (a < b) {
+      int tmp = a; a = b; b = tmp;
+    }
+    int root = a;
+    if (__atomic_compare_exchange_n (&p[a], &root, b, false,
+				     __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+      return;
+  }
+}
+
+static inline void droplet_link (int * p, int a, double b)
+{
+  int k = b;
+  if (__atomic_load_n (&p[k], __ATOMIC_RELAXED) >= 0)
+    droplet_unite (p, a, k);
+}
+
+static int droplet_cmp (const void * a, const void * b)
+{
+  double va = ((const Droplet *) a)->V, vb = ((const Droplet *) b)->V;
+  return va > vb ? -1 : va < vb;
+}
+
+#define DROPLET_NSUM 6
+
+/**
+With OpenMP, `npe()` is the size of the current team, that is 1
+outside of a parallel region: the arrays of the threads are sized with
+the largest team instead. */
+
+#if _OPENMP
+# define droplet_nthreads() omp_get_max_threads()
+#else
+# define droplet_nthreads() npe()
+#endif
+
+DropletList droplets_find (scalar c, vector u, double threshold)
+{
+  timer tm = timer_start();
+  LeafView * v = &droplet_state.view;
+  leaf_view_update (v, 0);
+  scalar index = v->index;
+  if (v->n > droplet_state.nmax) {
+    droplet_state.nmax = v->n;
+    droplet_state.parent = qrealloc (droplet_state.parent, v->n, int);
+    droplet_state.id = qrealloc (droplet_state.id, v->n, int);
+  }
+  int * p = droplet_state.parent, * id = droplet_state.id;
+
+  foreach() {
+    int k = index[];
+    p[k] = c[] > threshold ? k : -1;
+  }
+
+  foreach() {
+    int k = index[];
+    if (p[k] >= 0) {
+      if (!is_boundary (neighbor(1,0))) {
+	if (is_leaf (neighbor(1,0)))
+	  droplet_link (p, k, index[1,0]);
+	else if (is_refined (neighbor(1,0)))
+	  droplet_link (p, k, fine(index,2,0)),
+	    droplet_link (p, k, fine(index,2,1));
+	else
+	  droplet_link (p, k, coarse(index,1,0));
+      }
+      if (!is_boundary (neighbor(0,1))) {
+	if (is_leaf (neighbor(0,1)))
+	  droplet_link (p, k, index[0,1]);
+	else if (is_refined (neighbor(0,1)))
+	  droplet_link (p, k, fine(index,0,2)),
+	    droplet_link (p, k, fine(index,1,2));
+	else
+	  droplet_link (p, k, coarse(index,0,1));
+      }
+    }
+  }
+
+  foreach() {
+    int k = index[];
+    if (p[k] >= 0)
+      p[k] = droplet_find (p, k);
+  }
+  int n = 0;
+  for (int k = 0; k < v->n; k++)
+    if (p[k] == k)
+      id[k] = n++;
+
+  int nth = droplet_nthreads();
+  double * sum = qcalloc ((long) nth*n*DROPLET_NSUM, double);
+  foreach() {
+    int k = index[];
+    if (p[k] >= 0) {
+      double dV = 2.*pi*y*sq(Delta)*clamp (c[], 0., 1.);
+      double * s = sum + ((long) pid()*n + id[p[k]])*DROPLET_NSUM;
+      s[0] += dV;
+      s[1] += dV*x, s[2] += dV*y;
+      s[3] += dV*u.x[], s[4] += dV*u.y[];
+      s[5] += 1.;
+    }
+  }
+  DropletList l = {qcalloc (max (n, 1), Droplet), n};
+  for (int j = 0; j < n; j++) {
+    double s[DROPLET_NSUM] = {0};
+    for (int th = 0; th < nth; th++)
+      for (int m = 0; m < DROPLET_NSUM; m++)
+	s[m] += sum[((long) th*n + j)*DROPLET_NSUM + m];
+    double V = s[0] > 0. ? s[0] : 1.;
+    l.d[j] = (Droplet){s[0], {s[1]/V, s[2]/V}, {s[3]/V, s[4]/V}, s[5]};
+  }
+  free (sum);
+  qsort (l.d, n, sizeof (Droplet), droplet_cmp);
+
+  droplet_state.ncalls++;
+  droplet_state.ncells += v->n;
+  droplet_state.time += timer_elapsed (tm);
+  return l;
+}
+
+#if DROPLETS
+event droplet_series (t = 0; t += droplet_dt)
+{
+  DropletList l = droplets_find (f, u, droplet_threshold);
+  FILE * fp = fopen ("droplets", i == 0 ? "w" : "a");
+  if (i == 0)
+    fprintf (fp, "t k V x y ux uy ncells\n");
+  for (int k = 0; k < l.n; k++)
+    fprintf (fp, "%g %d %g %g %g %g %g %d\n", t, k, l.d[k].V,
+	     l.d[k].c.x, l.d[k].c.y, l.d[k].u.x, l.d[k].u.y, l.d[k].ncells);
+  fclose (fp);
+  free (l.d);
+}
+#endif
+
+event end (t = end)
+{
+  if (droplet_state.ncalls)
+    fprintf (ferr, "# droplets: %d labellings, %g s, %g ns/cell\n",
+	     droplet_state.ncalls, droplet_state.time,
+	     1e9*droplet_state.time/droplet_state.ncells);
+}
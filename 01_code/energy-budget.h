@@ -0,0 +1,108 @@
+/**
+# In-situ energy budget
+
+Every `budget_every` steps, the axisymmetric integrals
+($dV = 2\pi y\,dx\,dy$) of the terms of the energy budget are computed
+in a single reduction over the leaf cells and appended to the file
+`budget`:
+
+- `kel`, `keg`: kinetic energy of the liquid and of the gas,
+- `se`: surface energy $\sigma A$, with $A$ the area of the revolved
+  VOF facets,
+- `ee`: elastic energy stored in the medium,
+  $\frac{\mu_p}{2\lambda}\mathrm{tr}(\mathbf{A} - \mathbf{I})$,
+- `dv`: viscous dissipation rate of the solvent, $2\mu\mathbf{D}:\mathbf{D}$,
+- `dp`: plastic dissipation rate, $\eta\,\mathbf{\tau}_p:\mathbf{\tau}_p/(2\mu_p)$
+  with $\eta$ the switch term of the Saramito model,
+- `vl`, `vy`: liquid volume and yielded liquid volume,
+- `cost`: wall-clock time of the evaluation (s).
+
+With $\mathbf{f}_s(\mathbf{A}) = \mathbf{A} - \mathbf{I}$ (as in
+[saramito-EVP.h](saramito-EVP.h)) the elastic energy density is
+$\mathrm{tr}(\mathbf{\tau}_p)/2$. It is computed from the stress
+rather than from `trA`, which is only updated in the viscoelastic
+phase and not before the first step. The rate of deformation is that
+of [velocity-gradient.h](velocity-gradient.h).
+
+When [flow-topology.h](flow-topology.h) is included before this file, the
+histograms of the flow-topology parameter are accumulated in the same
+traversal, from the same velocity gradient, whenever they are due. */
+
+#include "velocity-gradient.h"
+
+int budget_every = 10; // steps between two evaluations (0 to disable)
+
+#ifdef TOPOLOGY_NSUMS
+# define BUDGET_TOPOLOGY TOPOLOGY_NSUMS
+#else
+# define BUDGET_TOPOLOGY 1
+#endif
+
+event energy_budget (i++)
+{
+  if (!budget_every || i % budget_every)
+    return 0;
+
+  evp_diagnostics();
+  timer tm = timer_start();
+  double kel = 0., keg = 0., se = 0., ee = 0., dv = 0., dp = 0.;
+  double vl = 0., vy = 0.;
+  double ts[BUDGET_TOPOLOGY] = {0};
+#ifdef TOPOLOGY_NSUMS
+  int nb = topology_nbins;
+  assert (nb > 0 && nb <= TOPOLOGY_MAXBINS);
+  bool topology = topology_due();
+#endif
+  foreach (reduction(+:kel) reduction(+:keg) reduction(+:se)
+	   reduction(+:ee) reduction(+:dv) reduction(+:dp)
+	   reduction(+:vl) reduction(+:vy) reduction(+:ts[:BUDGET_TOPOLOGY])) {
+    double dV = 2.*pi*y*sq(Delta);
+    double ff = clamp (f[], 0., 1.);
+    double u2 = sq(u.x[]) + sq(u.y[]);
+    kel += dV*0.5*rho1*ff*u2;
+    keg += dV*0.5*rho2*(1. - ff)*u2;
+    vl += dV*ff;
+
+    if (f[] > 1e-6 && f[] < 1. - 1e-6) {
+      coord n = interface_normal (point, f), p;
+      double alpha = plane_alpha (f[], n);
+      double area = plane_area_center (n, alpha, &p);
+      se += f.sigma*2.*pi*(y + p.y*Delta)*area*Delta;
+    }
+
+    vgrad gu = velocity_gradient (point, u, 1./(2.*Delta));
+    dv += dV*2.*mu(ff)*vgrad_DD (gu);
+#ifdef TOPOLOGY_NSUMS
+    if (topology && ff > 0.)
+      topology_add (ts, nb, dV*ff, gu, solidreg[] > 0.);
+#endif
+
+    if (lambda[] > 0. && mup[] > 0.) {
+      ee += dV*0.5*(tau_p.x.x[] + tau_p.y.y[] + tau_qq[]);
+      double nu = 1., eta = 1.;
+      if (f_r)
+	f_r (trA[], tau_p.x.x[], tau_p.x.y[], tau_p.y.y[], tau_qq[], tau0[],
+	     &nu, &eta);
+      dp += dV*eta*(sq(tau_p.x.x[]) + sq(tau_p.y.y[]) + sq(tau_qq[]) +
+		    2.*sq(tau_p.x.y[]))/(2.*mup[]);
+    }
+    if (solidreg[] > 0.)
+      vy += dV*ff;
+  }
+  double cost = timer_elapsed (tm);
+
+  static FILE * fp;
+  if (i == 0) {
+    fp = fopen ("budget", "w");
+    fprintf (fp, "i t kel keg se ee dv dp vl vy cost\n");
+  }
+  else
+    fp = fopen ("budget", "a");
+  fprintf (fp, "%d %g %g %g %g %g %g %g %g %g %g\n",
+	   i, t, kel, keg, se, ee, dv, dp, vl, vy, cost);
+  fclose (fp);
+#ifdef TOPOLOGY_NSUMS
+  if (topology)
+    topology_write (ts, nb);
+#endif
+}
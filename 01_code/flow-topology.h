@@ -0,0 +1,169 @@
+/**
+# In-situ flow topology
+
+The flow-topology parameter $\mathcal{Q}$ (see
+`03_supplementary_plots/01_flow_topology_definition_1` and
+`02_flow_topology_definition_2`) is computed during the run. Before,
+it was only computed from the full dumps by `restore_index.c`. With
+$$
+\|\mathcal{D}\| = \sqrt{\mathcal{D}:\mathcal{D}/2}, \qquad
+\|\mathcal{S}\| = \sqrt{\mathcal{S}:\mathcal{S}/2},
+$$
+the two definitions are
+$$
+\mathcal{Q}_1 = \frac{\|\mathcal{D}\|^2 - \|\mathcal{S}\|^2}
+                     {\|\mathcal{D}\|^2 + \|\mathcal{S}\|^2}, \qquad
+\mathcal{Q}_2 = \frac{\|\mathcal{D}\| - \|\mathcal{S}\|}
+                     {\|\mathcal{D}\| + \|\mathcal{S}\|},
+$$
+with $\mathcal{Q} = 1$ where the flow is idle.
+
+Every `topology_dt` the volume-weighted histograms of $\mathcal{Q}_1$
+and $\mathcal{Q}_2$ over the liquid and over its yielded region
+(`solidreg > 0`) are accumulated in a single reduction. When
+[energy-budget.h](energy-budget.h) is also compiled (`-DENERGY_BUDGET=1`),
+this reduction is part of the traversal of the budget, which computes the
+same velocity gradient, and the histograms are taken at the first
+evaluation of the budget after each `topology_dt` (so at most every
+`budget_every` steps). Otherwise the event below has its own traversal.
+The volume-averaged values and the liquid and yielded volumes are
+appended to `topology`, and the histograms (`topology_nbins` bins on
+$[-1,1]$, normalised by the volume of the region) to `topology-hist`, one
+line per definition and region:
+
+~~~
+t definition region h[0] ... h[nbins-1]
+~~~
+
+If `topology_raster` is set, $\|\mathcal{D}\|$, $\|\mathcal{S}\|$,
+$\mathcal{Q}_1$ and $\mathcal{Q}_2$ are also written as binary rasters
+(see [output-raster.h](output-raster.h)) with the gas masked, in
+`intermediate/topology-<t>.raster`. */
+
+#include "output-raster.h"
+#include "velocity-gradient.h"
+
+#define TOPOLOGY_MAXBINS 200
+
+double topology_dt = 0.005;  // interval between two evaluations
+int topology_nbins = 40;     // bins of the histograms (<= TOPOLOGY_MAXBINS)
+bool topology_raster = false;
+int topology_raster_n = 1024;
+
+/**
+Norms of the rate-of-deformation and rotation tensors in the cell,
+from the centred gradient of [velocity-gradient.h](velocity-gradient.h). */
+
+static inline void topology_norms (Point point, double * Dn, double * Sn)
+{
+  vgrad gu = velocity_gradient (point, u, 1./(2.*Delta));
+  *Dn = sqrt (vgrad_DD (gu)/2.);
+  *Sn = sqrt (vgrad_SS (gu)/2.);
+}
+
+static inline int topology_bin (double Q, int nbins)
+{
+  int b = (Q + 1.)/2.*nbins;
+  return clamp (b, 0, nbins - 1);
+}
+
+/**
+The sums of a reduction are held in one array: the four histograms
+($\mathcal{Q}_1$ and $\mathcal{Q}_2$ over the liquid, then over the
+yielded region), followed by the volumes and the volume integrals of
+$\mathcal{Q}_1$ and $\mathcal{Q}_2$. */
+
+#define TOPOLOGY_NSUMS (4*TOPOLOGY_MAXBINS + 6)
+#define TOPOLOGY_VL (4*TOPOLOGY_MAXBINS)
+
+static inline void topology_add (double * s, int nb, double dV, vgrad gu,
+				  bool yielded)
+{
+  double Dn = sqrt (vgrad_DD (gu)/2.), Sn = sqrt (vgrad_SS (gu)/2.);
+  double Q1 = topology_Q1 (Dn, Sn), Q2 = topology_Q2 (Dn, Sn);
+  int b1 = topology_bin (Q1, nb), b2 = topology_bin (Q2, nb);
+  double * v = s + TOPOLOGY_VL;
+  v[0] += dV, v[2] += dV*Q1, v[3] += dV*Q2;
+  s[b1] += dV, s[nb + b2] += dV;
+  if (yielded) {
+    v[1] += dV, v[4] += dV*Q1, v[5] += dV*Q2;
+    s[2*nb + b1] += dV, s[3*nb + b2] += dV;
+  }
+}
+
+/**
+`topology_due()` is true once per `topology_dt`, and is used by the
+budget to decide whether to accumulate the histograms. */
+
+double topology_next = 0.;
+
+bool topology_due()
+{
+  if (t < topology_next)
+    return false;
+  while (topology_next <= t)
+    topology_next += topology_dt;
+  return true;
+}
+
+void topology_write (const double * s, int nb)
+{
+  const double * v = s + TOPOLOGY_VL;
+  double vl = v[0], vy = v[1];
+  static FILE * fp, * fph;
+  if (i == 0) {
+    fp = fopen ("topology", "w");
+    fprintf (fp, "t vl vy Q1l Q2l Q1y Q2y\n");
+    fph = fopen ("topology-hist", "w");
+  }
+  else {
+    fp = fopen ("topology", "a");
+    fph = fopen ("topology-hist", "a");
+  }
+  fprintf (fp, "%g %g %g %g %g %g %g\n", t, vl, vy,
+	   vl > 0. ? v[2]/vl : 0., vl > 0. ? v[3]/vl : 0.,
+	   vy > 0. ? v[4]/vy : 0., vy > 0. ? v[5]/vy : 0.);
+  fclose (fp);
+  for (int k = 0; k < 4; k++) {
+    double vk = k < 2 ? vl : vy;
+    fprintf (fph, "%g %d %s", t, k % 2 + 1, k < 2 ? "liquid" : "yielded");
+    for (int b = 0; b < nb; b++)
+      fprintf (fph, " %g", vk > 0. ? s[k*nb + b]/vk : 0.);
+    fputc ('\n', fph);
+  }
+  fclose (fph);
+
+  if (topology_raster) {
+    scalar Dn[], Sn[], Q1[], Q2[];
+    foreach() {
+      double dn, sn;
+      topology_norms (point, &dn, &sn);
+      Dn[] = dn, Sn[] = sn;
+      Q1[] = topology_Q1 (dn, sn);
+      Q2[] = topology_Q2 (dn, sn);
+    }
+    char name[80];
+    sprintf (name, "intermediate/topology-%5.4f.raster", t);
+    FILE * fr = fopen (name, "w");
+    output_raster ({Dn, Sn, Q1, Q2}, fr, topology_raster_n, linear = true,
+		   mask = {f});
+    fclose (fr);
+  }
+}
+
+#if !ENERGY_BUDGET
+event flow_topology (t = 0; t += topology_dt)
+{
+  int nb = topology_nbins;
+  assert (nb > 0 && nb <= TOPOLOGY_MAXBINS);
+  evp_diagnostics();
+  double s[TOPOLOGY_NSUMS] = {0};
+  foreach (reduction(+:s[:TOPOLOGY_NSUMS])) {
+    double dV = 2.*pi*y*sq(Delta)*clamp (f[], 0., 1.);
+    if (dV > 0.)
+      topology_add (s, nb, dV, velocity_gradient (point, u, 1./(2.*Delta)),
+		    solidreg[] > 0.);
+  }
+  topology_write (s, nb);
+}
+#endif
@@ -0,0 +1,539 @@
+/**
+# Harness of the log-conformation and Saramito kernels
+
+Runs the per-cell kernels of [log-conform-kernels.h](log-conform-kernels.h)
+and [saramito-kernels.h](saramito-kernels.h) on plain arrays, outside
+of Basilisk, and compares them with references evaluated in long
+double:
+
+- `diag`: `diagonalization_2D()`, error of the eigenvalues (relative
+  to each eigenvalue), of the reconstruction $R \Lambda R^T$ and of the
+  orthogonality of $R$,
+- `log`: $\Psi = \log \mathbf{A}$ computed by `upper_convective()` (with
+  $\Delta t = 0$), relative to $\max(1, |\Psi|)$, and $\Psi_{\theta\theta}$,
+- `upper`: the upper convective increment of `upper_convective()`,
+  relative to $\Delta t\,|\nabla u|\,(2 + |\log \lambda_1/\lambda_2|)$.
+  The reference uses the regular form of the rotation term in the
+  eigenbasis,
+  $$
+  \tilde{\Psi}_{12} = (\lambda_2 M_{12} + \lambda_1 M_{21})
+  \frac{\log \lambda_2 - \log \lambda_1}{\lambda_2 - \lambda_1}
+  $$
+  (with `log1p()`), which has no singularity when $\lambda_1 \to \lambda_2$,
+- `model`: the stress of `model_term()`, relative to
+  $|\tau_p| + \mu_p/\lambda$, and the number of cells whose yield flag
+  differs from the reference,
+- `saramito_r`: the switch term $\eta$ of `saramito_r()` (absolute) and
+  the number of flags $\eta > $ `solidthresh` which differ.
+
+The synthetic inputs are
+
+- `generic`: conformation tensors with eigenvalues log-uniform in
+  $[10^{-3}, 10^3]$ and random orientation,
+- `degenerate`: $\mathbf{A} = \mathbf{I} + \epsilon \mathbf{E}$ with
+  $\epsilon$ from $10^{-16}$ to $10^{-6}$ (and $\epsilon = 0$),
+- `yield`: yield stresses within $10^{-15}$ to $10^{-1}$ (relative) of
+  the deviatoric stress $\tau_D$, or of the stress for which $\eta$ is
+  `solidthresh`,
+- `axis`: cells next to the axis ($y = \Delta/2$) with $A_{\theta\theta}$
+  from $10^{-12}$ to $1$ and $u_{\theta\theta} = u_y/y$.
+
+The files given on the command line, written by
+[record-kernel-inputs.c](record-kernel-inputs.c), are replayed as
+additional sets. Each kernel is then timed (ns per call, the best of
+`-r` repetitions over the set).
+
+$f_s$ and $f_r$ are those of the Saramito model, as in
+[burst_evp.c](burst_evp.c).
+
+~~~bash
+gcc -O2 -Wall kernel-bench.c -o kbench -lm
+./kbench -n 100000 -r 5 cells-*.kin
+~~~
+*/
+
+#define AXI 1
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "saramito-kernels.h"
+#include "log-conform-kernels.h"
+
+/**
+## Random inputs */
+
+static uint64_t rng_state = 1;
+
+static double rnd() // uniform in [0,1)
+{
+  uint64_t z = (rng_state += 0x9e3779b97f4a7c15);
+  z = (z ^ (z >> 30))*0xbf58476d1ce4e5b9;
+  z = (z ^ (z >> 27))*0x94d049bb133111eb;
+  z ^= z >> 31;
+  return (z >> 11)*0x1p-53;
+}
+
+static double rnd_range (double a, double b) { return a + (b - a)*rnd(); }
+static double rnd_log (double a, double b) { return a*pow (b/a, rnd()); }
+
+/**
+The reference stress is set so that the conformation tensor seen by
+the kernels is $\mathbf{A}$ ($f_s$ is 1 for Saramito, so
+$\tau_p = \mu_p/\lambda\,(\mathbf{A} - \mathbf{I})$). */
+
+static void set_conformation (KernelInput * c, double axx, double axy,
+			      double ayy, double aqq)
+{
+  double fa = c->mup/c->lambda;
+  c->Txx = fa*(axx - 1.), c->Txy = fa*axy, c->Tyy = fa*(ayy - 1.);
+  c->Tqq = c->tqq = fa*(aqq - 1.);
+  c->trA = axx + ayy + aqq;
+}
+
+static void random_material (KernelInput * c, int level)
+{
+  c->lambda = rnd_log (1e-2, 20.);
+  c->mup = rnd_range (0.1, 1.);
+  c->tau0 = rnd_range (0., 1.);
+  c->Delta = 8./(1 << level);
+  c->dt = 5e-4;
+  double G[4];
+  for (int k = 0; k < 4; k++)
+    G[k] = rnd_range (-1., 1.)*rnd_log (1e-2, 10.);
+  c->duxx = 2.*c->Delta*G[0], c->duxy = 2.*c->Delta*G[1];
+  c->duyx = 2.*c->Delta*G[2], c->duyy = 2.*c->Delta*G[3];
+  c->uqq = rnd_range (-1., 1.);
+}
+
+static void random_spd (double l1, double l2, double * axx, double * axy,
+			double * ayy)
+{
+  double th = rnd_range (0., M_PI), c = cos (th), s = sin (th);
+  *axx = c*c*l1 + s*s*l2;
+  *ayy = s*s*l1 + c*c*l2;
+  *axy = c*s*(l1 - l2);
+}
+
+static void set_generic (KernelInput * c)
+{
+  double axx, axy, ayy;
+  random_material (c, 11 + (int) (3*rnd()));
+  random_spd (rnd_log (1e-3, 1e3), rnd_log (1e-3, 1e3), &axx, &axy, &ayy);
+  set_conformation (c, axx, axy, ayy, rnd_log (1e-3, 1e3));
+}
+
+static void set_degenerate (KernelInput * c)
+{
+  random_material (c, 11 + (int) (3*rnd()));
+  double e = rnd() < 0.05 ? 0. : pow (10., - rnd_range (6., 16.));
+  set_conformation (c, 1. + e*rnd_range (-1., 1.), e*rnd_range (-1., 1.),
+		    1. + e*rnd_range (-1., 1.), 1. + e*rnd_range (-1., 1.));
+}
+
+static void set_yield (KernelInput * c)
+{
+  double axx, axy, ayy;
+  random_material (c, 11 + (int) (3*rnd()));
+  random_spd (rnd_log (0.1, 10.), rnd_log (0.1, 10.), &axx, &axy, &ayy);
+  set_conformation (c, axx, axy, ayy, rnd_log (0.1, 10.));
+  double t1 = c->Txx, t2 = c->Txy, t3 = c->Tyy, t4 = c->Tqq;
+  double tauD = sqrt ((sq(t1 - t3) + sq(t3 - t4) + sq(t4 - t1))/6. + sq(t2));
+  double target = rnd() < 0.5 ? 0. : solidthresh;
+  c->tau0 = tauD - target*(tauD + myeps) +
+    (rnd() < 0.5 ? -1. : 1.)*tauD*pow (10., - rnd_range (1., 15.));
+}
+
+static void set_axis (KernelInput * c)
+{
+  double axx, axy, ayy;
+  int level = 11 + (int) (3*rnd());
+  random_material (c, level);
+  random_spd (rnd_log (1e-2, 1e2), rnd_log (1e-2, 1e2), &axx, &axy, &ayy);
+  set_conformation (c, axx, axy, ayy, rnd_log (1e-12, 1.));
+  double y = c->Delta/2., uy = rnd_range (-1., 1.)*y + rnd_range (-1., 1.)*sq(c->Delta);
+  c->uqq = uy/y;
+}
+
+/**
+## References in long double */
+
+typedef long double real;
+
+typedef struct { real l1, l2; real v1x, v1y; } Eigen; // l1 >= l2, v2 = (-v1y, v1x)
+
+static Eigen eigen_ref (real a, real b, real d)
+{
+  Eigen e;
+  real m = (a + d)/2., h = hypotl ((a - d)/2., b);
+  e.l1 = m + h;
+  e.l2 = e.l1 != 0. ? (a*d - b*b)/e.l1 : m - h;
+  if (h == 0.) {
+    e.v1x = 1., e.v1y = 0.;
+    return e;
+  }
+  real px = b, py = e.l1 - a, qx = e.l1 - d, qy = b;
+  if (px*px + py*py < qx*qx + qy*qy)
+    px = qx, py = qy;
+  real n = hypotl (px, py);
+  e.v1x = px/n, e.v1y = py/n;
+  return e;
+}
+
+/**
+$(\log \lambda_2 - \log \lambda_1)/(\lambda_2 - \lambda_1)$ */
+
+static real dlog (real l1, real l2)
+{
+  real d = l2 - l1;
+  return d == 0. ? 1./l1 : log1pl (d/l1)/d;
+}
+
+static real ref_switch (const KernelInput * c)
+{
+  real t1 = c->Txx, t2 = c->Txy, t3 = c->Tyy, t4 = c->Tqq;
+  real tauD = sqrtl (((t1 - t3)*(t1 - t3) + (t3 - t4)*(t3 - t4) +
+		      (t4 - t1)*(t4 - t1))/6. + t2*t2);
+  real s = (tauD - c->tau0)/(tauD + myeps);
+  return s > 0. ? s : 0.;
+}
+
+typedef struct { real xx, xy, yy, qq; } RefPsi;
+
+/**
+$\Psi$ at the beginning of the step and after the upper convective
+term. */
+
+static void ref_upper (const KernelInput * c, RefPsi * P0, RefPsi * P1)
+{
+  real fa = (real) c->lambda/c->mup;
+  real axx = fa*c->Txx + 1., axy = fa*c->Txy, ayy = fa*c->Tyy + 1.;
+  Eigen e = eigen_ref (axx, axy, ayy);
+  real v1x = e.v1x, v1y = e.v1y, v2x = - v1y, v2y = v1x;
+  real g1 = logl (e.l1), g2 = logl (e.l2);
+  P0->xx = v1x*v1x*g1 + v2x*v2x*g2;
+  P0->xy = v1x*v1y*g1 + v2x*v2y*g2;
+  P0->yy = v1y*v1y*g1 + v2y*v2y*g2;
+  P0->qq = logl (1. + fa*c->tqq);
+
+  real h = 2.*c->Delta;
+  real Gxx = c->duxx/h, Gxy = c->duxy/h, Gyx = c->duyx/h, Gyy = c->duyy/h;
+  real M11 = v1x*(Gxx*v1x + Gxy*v1y) + v1y*(Gyx*v1x + Gyy*v1y);
+  real M22 = v2x*(Gxx*v2x + Gxy*v2y) + v2y*(Gyx*v2x + Gyy*v2y);
+  real M12 = v1x*(Gxx*v2x + Gxy*v2y) + v1y*(Gyx*v2x + Gyy*v2y);
+  real M21 = v2x*(Gxx*v1x + Gxy*v1y) + v2y*(Gyx*v1x + Gyy*v1y);
+  real w = (e.l2*M12 + e.l1*M21)*dlog (e.l1, e.l2);
+  real dt = c->dt, d1 = 2.*dt*M11, d2 = 2.*dt*M22, o = dt*w;
+  P1->xx = P0->xx + v1x*v1x*d1 + v2x*v2x*d2 + 2.*v1x*v2x*o;
+  P1->yy = P0->yy + v1y*v1y*d1 + v2y*v2y*d2 + 2.*v1y*v2y*o;
+  P1->xy = P0->xy + v1x*v1y*d1 + v2x*v2y*d2 + (v1x*v2y + v1y*v2x)*o;
+  P1->qq = P0->qq + 2.*dt*c->uqq;
+}
+
+static void ref_model (const KernelInput * c, const pseudo_t * P, double Pqq,
+		       real * tau, real * yielded)
+{
+  Eigen e = eigen_ref (P->x.x, P->x.y, P->y.y);
+  real v1x = e.v1x, v1y = e.v1y, v2x = - v1y, v2y = v1x;
+  real l1 = expl (e.l1), l2 = expl (e.l2);
+  real eta = ref_switch (c);
+  *yielded = eta > solidthresh ? 1. : -1.;
+  real fa = expl (- eta*c->dt/c->lambda), s = (real) c->mup/c->lambda;
+  tau[0] = s*fa*(v1x*v1x*l1 + v2x*v2x*l2 - 1.);
+  tau[1] = s*fa*(v1x*v1y*l1 + v2x*v2y*l2);
+  tau[2] = s*fa*(v1y*v1y*l1 + v2y*v2y*l2 - 1.);
+  tau[3] = s*fa*(expl (Pqq) - 1.);
+}
+
+/**
+## Error statistics */
+
+typedef struct {
+  const char * name;
+  double max, sum2;
+  long n, nonfinite, flags;
+  double ns;
+} Stat;
+
+static void stat_add (Stat * s, double e)
+{
+  if (!isfinite (e))
+    s->nonfinite++;
+  else {
+    if (e > s->max)
+      s->max = e;
+    s->sum2 += e*e;
+  }
+  s->n++;
+}
+
+static void stat_print (const char * set, Stat * s)
+{
+  long nf = s->n - s->nonfinite;
+  char ns[16] = "-";
+  if (s->ns > 0.)
+    sprintf (ns, "%.3g", s->ns);
+  printf ("%-12s %-14s %9ld %9s %10.3g %10.3g %9ld %7ld\n", set, s->name,
+	  s->n, ns, s->max, nf ? sqrt (s->sum2/nf) : 0., s->nonfinite, s->flags);
+}
+
+static double now()
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9*ts.tv_nsec;
+}
+
+static volatile double sink;
+
+/**
+## Evaluation of one set */
+
+static void run_set (const char * set, const KernelInput * in, long n, int nrep)
+{
+  enum {S_EIG, S_REC, S_ORTH, S_LOG, S_LOGQQ, S_UPPER, S_UPPERQQ,
+	S_MODEL, S_SWITCH, S_N};
+  Stat s[S_N] = {
+    {"diag eig"}, {"diag rec"}, {"diag orth"}, {"log"}, {"log qq"},
+    {"upper"}, {"upper qq"}, {"model"}, {"saramito_r"}
+  };
+
+  pseudo_t * Psi = malloc (n*sizeof(pseudo_t));
+  double * Psiqq = malloc (n*sizeof(double));
+
+  for (long k = 0; k < n; k++) {
+    const KernelInput * c = &in[k];
+    pseudo_t T = {{c->Txx, c->Txy}, {c->Txy, c->Tyy}};
+    pseudo_t du = {{c->duxx, c->duxy}, {c->duyx, c->duyy}};
+    if (c->lambda == 0.) {
+      Psi[k] = (pseudo_t){{0., 0.}, {0., 0.}}, Psiqq[k] = 0.;
+      continue;
+    }
+
+    /**
+    Eigen-decomposition of the conformation tensor. */
+
+    double fa = c->lambda/c->mup;
+    pseudo_t A = {{fa*c->Txx + 1., fa*c->Txy}, {fa*c->Txy, fa*c->Tyy + 1.}};
+    pseudo_t R;
+    pseudo_v L;
+    diagonalization_2D (&L, &R, &A);
+    Eigen e = eigen_ref (A.x.x, A.x.y, A.y.y);
+    real lmax = L.x > L.y ? L.x : L.y, lmin = L.x > L.y ? L.y : L.x;
+    real el = fabsl (lmax - e.l1)/fabsl (e.l1), el2 = fabsl (lmin - e.l2)/fabsl (e.l2);
+    stat_add (&s[S_EIG], el > el2 ? el : el2);
+    real Ax = fabsl (A.x.x) + fabsl (A.x.y);
+    if (fabsl (A.y.x) + fabsl (A.y.y) > Ax)
+      Ax = fabsl (A.y.x) + fabsl (A.y.y);
+    real r[3] = {
+      (real) R.x.x*R.x.x*L.x + (real) R.x.y*R.x.y*L.y - A.x.x,
+      (real) R.x.x*R.y.x*L.x + (real) R.x.y*R.y.y*L.y - A.x.y,
+      (real) R.y.x*R.y.x*L.x + (real) R.y.y*R.y.y*L.y - A.y.y
+    };
+    stat_add (&s[S_REC], (fabsl (r[0]) + fabsl (r[1]) + fabsl (r[2]))/Ax);
+    real o[3] = {
+      (real) R.x.x*R.x.x + (real) R.y.x*R.y.x - 1.,
+      (real) R.x.x*R.x.y + (real) R.y.x*R.y.y,
+      (real) R.x.y*R.x.y + (real) R.y.y*R.y.y - 1.
+    };
+    stat_add (&s[S_ORTH], fabsl (o[0]) + fabsl (o[1]) + fabsl (o[2]));
+
+    /**
+    $\Psi$ and the upper convective term. */
+
+    RefPsi P0, P1;
+    ref_upper (c, &P0, &P1);
+    pseudo_t Q0, Q1;
+    double q0, q1;
+    upper_convective (c->lambda, c->mup, c->tau0, c->trA, &T, c->Tqq, c->tqq,
+		      &du, c->uqq, c->Delta, 0., &Q0, &q0);
+    upper_convective (c->lambda, c->mup, c->tau0, c->trA, &T, c->Tqq, c->tqq,
+		      &du, c->uqq, c->Delta, c->dt, &Q1, &q1);
+    real pmax = fmaxl (fabsl (P0.xx), fmaxl (fabsl (P0.xy), fabsl (P0.yy)));
+    real e0 = fmaxl (fabsl (Q0.x.x - P0.xx),
+		     fmaxl (fabsl (Q0.x.y - P0.xy), fabsl (Q0.y.y - P0.yy)));
+    stat_add (&s[S_LOG], e0/fmaxl (1., pmax));
+    stat_add (&s[S_LOGQQ], fabsl (q0 - P0.qq)/fmaxl (1., fabsl (P0.qq)));
+
+    real gmax = fmaxl (fmaxl (fabsl (c->duxx), fabsl (c->duxy)),
+		       fmaxl (fabsl (c->duyx), fabsl (c->duyy)))/(2.*c->Delta);
+    real scale = c->dt*gmax*(2. + fabsl (logl (e.l1/e.l2)));
+    real e1 = fmaxl (fabsl ((Q1.x.x - Q0.x.x) - (P1.xx - P0.xx)),
+		     fmaxl (fabsl ((Q1.x.y - Q0.x.y) - (P1.xy - P0.xy)),
+			    fabsl ((Q1.y.y - Q0.y.y) - (P1.yy - P0.yy))));
+    stat_add (&s[S_UPPER], scale > 0. ? e1/scale : e1);
+    stat_add (&s[S_UPPERQQ], fabsl ((q1 - q0) - (P1.qq - P0.qq))/
+	      fmaxl (2.*c->dt*fabs (c->uqq), 1e-300));
+
+    /**
+    The model term starts from the reference $\Psi$, rounded to
+    double. */
+
+    Psi[k] = (pseudo_t){{P1.xx, P1.xy}, {P1.xy, P1.yy}}, Psiqq[k] = P1.qq;
+    pseudo_t tau;
+    double tauqq, trAn, yielded;
+    model_term (c->lambda, c->mup, c->tau0, c->trA, &T, c->Tqq, &Psi[k],
+		Psiqq[k], &du, c->uqq, c->Delta, c->dt,
+		&tau, &tauqq, &trAn, &yielded);
+    real tr[4], yr;
+    ref_model (c, &Psi[k], Psiqq[k], tr, &yr);
+    real tmax = fmaxl (fmaxl (fabsl (tr[0]), fabsl (tr[1])),
+		       fmaxl (fabsl (tr[2]), fabsl (tr[3])));
+    real em = fmaxl (fmaxl (fabsl (tau.x.x - tr[0]), fabsl (tau.x.y - tr[1])),
+		     fmaxl (fabsl (tau.y.y - tr[2]), fabsl (tauqq - tr[3])));
+    stat_add (&s[S_MODEL], em/(tmax + c->mup/c->lambda));
+    if (yielded != yr)
+      s[S_MODEL].flags++;
+
+    /**
+    The switch term. */
+
+    double nu, eta;
+    saramito_r (c->trA, c->Txx, c->Txy, c->Tyy, c->Tqq, c->tau0, &nu, &eta);
+    real er = ref_switch (c);
+    stat_add (&s[S_SWITCH], fabsl (eta - er));
+    if ((eta > solidthresh) != (er > solidthresh))
+      s[S_SWITCH].flags++;
+  }
+
+  /**
+  ## Timing
+
+  The best of `nrep` passes over the set, for each kernel. */
+
+  double best[4] = {HUGE_VAL, HUGE_VAL, HUGE_VAL, HUGE_VAL};
+  for (int r = 0; r < nrep; r++) {
+    double acc = 0., t0 = now();
+    for (long k = 0; k < n; k++) {
+      const KernelInput * c = &in[k];
+      double fa = c->lambda/c->mup;
+      pseudo_t A = {{fa*c->Txx + 1., fa*c->Txy}, {fa*c->Txy, fa*c->Tyy + 1.}}, R;
+      pseudo_v L;
+      diagonalization_2D (&L, &R, &A);
+      acc += L.x + R.x.y;
+    }
+    double t1 = now();
+    for (long k = 0; k < n; k++) {
+      const KernelInput * c = &in[k];
+      pseudo_t T = {{c->Txx, c->Txy}, {c->Txy, c->Tyy}};
+      pseudo_t du = {{c->duxx, c->duxy}, {c->duyx, c->duyy}}, P;
+      double q;
+      upper_convective (c->lambda, c->mup, c->tau0, c->trA, &T, c->Tqq, c->tqq,
+			&du, c->uqq, c->Delta, c->dt, &P, &q);
+      acc += P.x.y + q;
+    }
+    double t2 = now();
+    for (long k = 0; k < n; k++) {
+      const KernelInput * c = &in[k];
+      pseudo_t T = {{c->Txx, c->Txy}, {c->Txy, c->Tyy}};
+      pseudo_t du = {{c->duxx, c->duxy}, {c->duyx, c->duyy}}, tau;
+      double tauqq, trAn, yielded;
+      model_term (c->lambda, c->mup, c->tau0, c->trA, &T, c->Tqq, &Psi[k],
+		  Psiqq[k], &du, c->uqq, c->Delta, c->dt,
+		  &tau, &tauqq, &trAn, &yielded);
+      acc += tau.x.y + yielded;
+    }
+    double t3 = now();
+    for (long k = 0; k < n; k++) {
+      const KernelInput * c = &in[k];
+      double nu, eta;
+      saramito_r (c->trA, c->Txx, c->Txy, c->Tyy, c->Tqq, c->tau0, &nu, &eta);
+      acc += eta;
+    }
+    double t4 = now(), dt[4] = {t1 - t0, t2 - t1, t3 - t2, t4 - t3};
+    for (int j = 0; j < 4; j++)
+      if (dt[j] < best[j])
+	best[j] = dt[j];
+    sink += acc;
+  }
+  s[S_EIG].ns = 1e9*best[0]/n;
+  s[S_UPPER].ns = 1e9*best[1]/n;
+  s[S_MODEL].ns = 1e9*best[2]/n;
+  s[S_SWITCH].ns = 1e9*best[3]/n;
+
+  for (int j = 0; j < S_N; j++)
+    stat_print (set, &s[j]);
+  free (Psi);
+  free (Psiqq);
+}
+
+/**
+## Recorded inputs */
+
+static KernelInput * read_inputs (const char * name, long * n)
+{
+  FILE * fp = fopen (name, "r");
+  if (!fp) {
+    perror (name);
+    exit (1);
+  }
+  char magic[8];
+  int32_t nr;
+  if (fread (magic, 1, 8, fp) != 8 || memcmp (magic, KERNEL_INPUT_MAGIC, 8) ||
+      fread (&nr, sizeof(int32_t), 1, fp) != 1 || nr < 0) {
+    fprintf (stderr, "kernel-bench: %s is not a file of kernel inputs\n", name);
+    exit (1);
+  }
+  KernelInput * in = malloc ((nr + 1)*sizeof(KernelInput));
+  if (fread (in, sizeof(KernelInput), nr, fp) != nr) {
+    fprintf (stderr, "kernel-bench: %s is truncated\n", name);
+    exit (1);
+  }
+  fclose (fp);
+  *n = nr;
+  return in;
+}
+
+int main (int argc, char * argv[])
+{
+  long n = 100000;
+  int nrep = 5, opt;
+  while ((opt = getopt (argc, argv, "n:r:s:")) != -1)
+    switch (opt) {
+    case 'n': n = atol (optarg); break;
+    case 'r': nrep = atoi (optarg); break;
+    case 's': rng_state = atol (optarg); break;
+    default:
+      fprintf (stderr, "usage: %s [-n cases] [-r repetitions] [-s seed] "
+	       "[recorded ...]\n", argv[0]);
+      return 1;
+    }
+
+  f_s = saramito_s;
+  f_r = saramito_r;
+
+  printf ("%-12s %-14s %9s %9s %10s %10s %9s %7s\n", "set", "kernel", "n",
+	  "ns/call", "max err", "rms err", "nonfinite", "flags");
+
+  struct {
+    const char * name;
+    void (* set) (KernelInput *);
+  } sets[] = {
+    {"generic", set_generic},
+    {"degenerate", set_degenerate},
+    {"yield", set_yield},
+    {"axis", set_axis},
+    {NULL}
+  };
+  KernelInput * in = malloc (n*sizeof(KernelInput));
+  for (int j = 0; sets[j].name; j++) {
+    for (long k = 0; k < n; k++)
+      sets[j].set (&in[k]);
+    run_set (sets[j].name, in, n, nrep);
+  }
+  free (in);
+
+  for (int j = optind; j < argc; j++) {
+    long nr;
+    KernelInput * r = read_inputs (argv[j], &nr);
+    const char * base = strrchr (argv[j], '/');
+    run_set (base ? base + 1 : argv[j], r, nr, nrep);
+    free (r);
+  }
+  return 0;
+}
@@ -0,0 +1,88 @@
+/**
+# Packed leaf-cell view
+
+`foreach()` visits the leaf cells of the quadtree in space-filling-curve
+(Morton) order, but each field lives in its own array and neighbour
+accesses go through the tree. A `LeafView` numbers the leaf cells in
+traversal order so that per-cell work can be gathered into contiguous
+structure-of-arrays buffers, done in plain loops, and scattered back.
+
+The numbering and the geometry stored with it only depend on the tree.
+They are rebuilt when [adapt_wavelet_limited()](adapt_wavelet_limited.h)
+has actually refined or coarsened cells since the last call. */
+
+#include "adapt_wavelet_limited.h"
+
+#define LEAF_VIEW_MAXBUF 32
+
+typedef struct {
+  bool built;
+  int n, nmax;               // number of leaf cells, allocated size
+  int generation;            // value of adapt_generation when built
+  scalar index;              // position of each leaf cell in the buffers
+  double * Delta, * y;       // geometry of each leaf cell
+  int nbuf;
+  double * buf[LEAF_VIEW_MAXBUF];
+  int nbuild;
+  double build, gather, kernel, scatter; // accumulated times (s)
+} LeafView;
+
+/**
+Makes sure that the numbering is up to date and that `nbuf` buffers
+of (at least) one double per leaf cell are allocated. */
+
+void leaf_view_update (LeafView * v, int nbuf)
+{
+  assert (nbuf <= LEAF_VIEW_MAXBUF);
+  if (v->built && v->generation == adapt_generation && nbuf <= v->nbuf)
+    return;
+
+  timer tm = timer_start();
+  if (!v->built) {
+    v->index = new scalar;
+    v->index.nodump = true;
+  }
+  scalar index = v->index;
+  int n = 0;
+  foreach (serial)
+    index[] = n++;
+
+  if (n > v->nmax || nbuf > v->nbuf) {
+    v->nmax = max (n, v->nmax);
+    v->Delta = qrealloc (v->Delta, v->nmax, double);
+    v->y = qrealloc (v->y, v->nmax, double);
+    for (int b = 0; b < nbuf; b++)
+      v->buf[b] = qrealloc (v->buf[b], v->nmax, double);
+    v->nbuf = max (nbuf, v->nbuf);
+  }
+  v->n = n;
+
+  double * vDelta = v->Delta, * vy = v->y;
+  foreach() {
+    int k = index[];
+    vDelta[k] = Delta;
+    vy[k] = y;
+  }
+
+  v->built = true;
+  v->generation = adapt_generation;
+  v->nbuild++;
+  v->build += timer_elapsed (tm);
+}
+
+void leaf_view_report (const LeafView * v, const char * name, FILE * fp)
+{
+  fprintf (fp, "# leaf view (%s): %d cells, %d rebuilds\n"
+	   "# build %g s, gather %g s, kernel %g s, scatter %g s\n",
+	   name, v->n, v->nbuild, v->build, v->gather, v->kernel, v->scatter);
+}
+
+void leaf_view_free (LeafView * v)
+{
+  if (v->built)
+    delete ({v->index});
+  free (v->Delta), free (v->y);
+  for (int b = 0; b < v->nbuf; b++)
+    free (v->buf[b]);
+  *v = (LeafView){0};
+}
@@ -0,0 +1,209 @@
+/**
+# Preview of level-of-detail snapshots
+
+Reads the snapshots written by [output-lod.h](output-lod.h) up to
+level `level` only, that is a prefix of each file, and writes one line
+per snapshot
+
+~~~
+file t level cells bytes ms volume xtip vjet droplets
+~~~
+
+with the number of cells of the preview, the bytes read, the time
+spent (reading and analysis), the axisymmetric volume of the liquid,
+the axial position of the tip of the liquid on the axis, the largest
+axial velocity of the liquid there and the number of droplets (the
+connected components of $f > 1/2$ on the $2^L \times 2^L$ raster of
+the preview). The totals (bytes read against the size of the files,
+and time) are printed at the end, so that a pass over the whole run
+can be compared with the same pass at full resolution (`-l 99`).
+
+~~~bash
+gcc -O2 -Wall lod-preview.c -o lod-preview -lm
+./lod-preview [-l level] intermediate/lod-*
+~~~
+
+The default level is 8. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <getopt.h>
+#include <sys/stat.h>
+
+#define LOD_NAMELEN 32
+
+typedef struct {
+  int nf, depth;
+  double t, X0, Y0, L0;
+  char (* names)[LOD_NAMELEN];
+  int64_t * table;
+  char * buf;
+  long bytes;
+} Lod;
+
+static double wall()
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+static long pad (long n)
+{
+  return (n + 7) & ~7L;
+}
+
+/**
+The header is read first, then the blocks of levels 0 to `level`,
+which are contiguous. */
+
+static int lod_read (const char * name, int level, Lod * lod)
+{
+  FILE * fp = fopen (name, "r");
+  if (!fp) {
+    perror (name);
+    return 0;
+  }
+  char h[64];
+  if (fread (h, 1, 64, fp) != 64 || strncmp (h, "EVPLOD01", 8)) {
+    fprintf (stderr, "%s: not a level-of-detail snapshot\n", name);
+    fclose (fp);
+    return 0;
+  }
+  int32_t ih[3];
+  memcpy (ih, h + 8, sizeof(ih));
+  memcpy (&lod->t, h + 24, sizeof(double));
+  memcpy (&lod->X0, h + 32, sizeof(double));
+  memcpy (&lod->Y0, h + 40, sizeof(double));
+  memcpy (&lod->L0, h + 48, sizeof(double));
+  lod->nf = ih[1], lod->depth = level < ih[2] ? level : ih[2];
+  long header = ih[0];
+  char * hdr = malloc (header);
+  memcpy (hdr, h, 64);
+  if (fread (hdr + 64, 1, header - 64, fp) != (size_t) (header - 64)) {
+    fprintf (stderr, "%s: truncated header\n", name);
+    free (hdr), fclose (fp);
+    return 0;
+  }
+  int64_t * table = (int64_t *) (hdr + 64 + lod->nf*LOD_NAMELEN);
+  int d = lod->depth;
+  long end = table[2*d] + pad (table[2*d + 1]) +
+    (2 + lod->nf)*pad (4*table[2*d + 1]);
+  lod->buf = malloc (end);
+  memcpy (lod->buf, hdr, header);
+  free (hdr);
+  if (fread (lod->buf + header, 1, end - header, fp) != (size_t) (end - header)) {
+    fprintf (stderr, "%s: truncated\n", name);
+    free (lod->buf), fclose (fp);
+    return 0;
+  }
+  fclose (fp);
+  lod->names = (char (*)[LOD_NAMELEN]) (lod->buf + 64);
+  lod->table = (int64_t *) (lod->buf + 64 + lod->nf*LOD_NAMELEN);
+  lod->bytes = end;
+  return 1;
+}
+
+static const float * lod_field (const Lod * lod, int l, const char * name)
+{
+  long n = lod->table[2*l + 1];
+  for (int k = 0; k < lod->nf; k++)
+    if (!strncmp (lod->names[k], name, LOD_NAMELEN))
+      return (float *) (lod->buf + lod->table[2*l] + pad (n) + (2 + k)*pad (4*n));
+  return NULL;
+}
+
+/**
+Connected components (4-neighbours) of the marked pixels, with an
+explicit stack. */
+
+static int components (uint8_t * mask, int n)
+{
+  int count = 0;
+  long * stack = malloc (sizeof(long)*n*n);
+  for (long p0 = 0; p0 < (long) n*n; p0++)
+    if (mask[p0] == 1) {
+      long sp = 0;
+      stack[sp++] = p0, mask[p0] = 2;
+      while (sp) {
+	long p = stack[--sp];
+	int i = p % n, j = p / n;
+	long nb[4] = {i > 0 ? p - 1 : -1, i < n - 1 ? p + 1 : -1,
+		      j > 0 ? p - n : -1, j < n - 1 ? p + n : -1};
+	for (int k = 0; k < 4; k++)
+	  if (nb[k] >= 0 && mask[nb[k]] == 1)
+	    stack[sp++] = nb[k], mask[nb[k]] = 2;
+      }
+      count++;
+    }
+  free (stack);
+  return count;
+}
+
+int main (int argc, char * argv[])
+{
+  int level = 8, opt;
+  while ((opt = getopt (argc, argv, "l:")) != -1)
+    switch (opt) {
+    case 'l': level = atoi (optarg); break;
+    default:
+      fprintf (stderr, "usage: %s [-l level] file...\n", argv[0]);
+      return 1;
+    }
+
+  printf ("file t level cells bytes ms volume xtip vjet droplets\n");
+  long bytes = 0, total = 0, files = 0;
+  double elapsed = 0.;
+  for (int a = optind; a < argc; a++) {
+    double start = wall();
+    Lod lod;
+    if (!lod_read (argv[a], level, &lod))
+      continue;
+    int L = lod.depth, n = 1 << L;
+    uint8_t * mask = calloc ((long) n*n, 1);
+    double volume = 0., xtip = - HUGE_VAL, vjet = 0.;
+    long cells = 0;
+    for (int l = 0; l <= L; l++) {
+      long nc = lod.table[2*l + 1];
+      const uint8_t * leaf = (uint8_t *) (lod.buf + lod.table[2*l]);
+      const int32_t * ci = (int32_t *) ((char *) leaf + pad (nc));
+      const int32_t * cj = (int32_t *) ((char *) ci + pad (4*nc));
+      const float * f = lod_field (&lod, l, "f"), * ux = lod_field (&lod, l, "u.x");
+      double delta = lod.L0/(1 << l);
+      int s = 1 << (L - l);
+      for (long c = 0; f && c < nc; c++)
+	if (leaf[c] || l == L) {
+	  double x = lod.X0 + (ci[c] + 0.5)*delta, y = lod.Y0 + (cj[c] + 0.5)*delta;
+	  volume += f[c]*2.*M_PI*y*delta*delta;
+	  cells++;
+	  if (f[c] > 0.5) {
+	    if (y < delta) {
+	      if (x + delta/2. > xtip)
+		xtip = x + delta/2.;
+	      if (ux && ux[c] > vjet)
+		vjet = ux[c];
+	    }
+	    for (int j = cj[c]*s; j < (cj[c] + 1)*s; j++)
+	      memset (mask + (long) j*n + ci[c]*s, 1, s);
+	  }
+	}
+    }
+    int droplets = components (mask, n);
+    free (mask);
+    double ms = 1e3*(wall() - start);
+    struct stat st;
+    if (!stat (argv[a], &st))
+      total += st.st_size;
+    bytes += lod.bytes, elapsed += ms, files++;
+    printf ("%s %g %d %ld %ld %.3g %g %g %g %d\n", argv[a], lod.t, L, cells,
+	    lod.bytes, ms, volume, xtip, vjet, droplets);
+    free (lod.buf);
+  }
+  fprintf (stderr, "# %ld files, %ld bytes read of %ld (%.3g%%), %.3g s\n",
+	   files, bytes, total, total ? 100.*bytes/total : 0., elapsed/1e3);
+  return 0;
+}
@@ -123,11 +123,14 @@ Constitutive models other than Oldroyd-B (the default) are defined
 through the two functions $\mathbf{f}_s (\mathbf{A})$ and
 $\mathbf{f}_r (\mathbf{A})$. 
 
-#EVP: For Saramito model, notice the additional inputs. 
-*/
+#EVP: For Saramito model, notice the additional inputs.
+
+The two functions, the per-cell kernels of the scheme below and the
+types they use are plain C, in
+[log-conform-kernels.h](log-conform-kernels.h), so that they can also
+be called outside of the grid (see [kernel-bench.c](kernel-bench.c)). */
 
-void (* f_s) (double, double, double, double, double, double, double *, double *) = NULL;
-void (* f_r) (double, double, double, double, double, double, double *, double *) = NULL;
+#include "log-conform-kernels.h"
 
 /**
 ## The log conformation approach
@@ -181,6 +184,7 @@ We will use the Bell--Collela--Glaz scheme to advect the log-conformation
 tensor $\Psi$. */
 
 #include "bcg.h"
+#include "velocity-gradient.h"
 
 /**
 ## Variables
@@ -191,37 +195,139 @@ constitutive viscoelastic models other than Oldroyd-B.  */
 
 symmetric tensor tau_p[]; // This is the actual stress, but used during the iteration to store psi
                           // so will not be correct in the middle of a time step
-symmetric tensor mytaup[]; // This is the one that does not change during the iteration
 #if AXI
 scalar tau_qq[];
+#endif
+
+/**
+#EVP: The reference copy of the stress ($\mathbf{\tau}_p$ at the
+beginning of the step) is only ever accessed at the cell itself, through
+`ref_stress_set()` and `ref_stress_get()`. */
+
+symmetric tensor mytaup[]; // This is the one that does not change during the iteration
+#if AXI
 scalar mytauqq[];
 #endif
 
+static inline void ref_stress_set (Point point, double txx, double txy,
+				   double tyy, double tqq)
+{
+  mytaup.x.x[] = txx;
+  mytaup.x.y[] = txy;
+  mytaup.y.y[] = tyy;
+#if AXI
+  mytauqq[] = tqq;
+#endif
+}
+
 (const) scalar trA = zeroc;
 scalar solidreg;          // [-1,1] := -1 indicates un-yielded and 1 indicates yielded
-double solidthresh=1e-4; // Yield-surface is plotted when K > solidthresh, where K is the switch-term; One could essentially set this to 0 to 0.001 (threshold value for refinement)
+
+/**
+### Diagnostic fields
+
+In the Saramito setup, `trA` and `solidreg` are not needed by the
+scheme itself ($\mathbf{f}_s$ and $\mathbf{f}_r$ do not depend on the
+trace): they are only read by the refinement criterion and the
+outputs. With `EVP_LAZY_DIAGNOSTICS` they are not solver fields. The
+model term does not write them, and they are allocated the first time
+a consumer calls `evp_diagnostics()`. They are then computed from the
+current stress, at most once per step:
+$$
+\mathrm{tr}\,\mathbf{A} = \mathrm{tr}\,\frac{1}{\nu}\left(\frac{\lambda}{\mu_p
+\eta}\mathbf{\tau}_p + \mathbf{I}\right)
+$$
+with $\nu$ and $\eta$ given by $\mathbf{f}_s$, and `solidreg` from the
+switch term of $\mathbf{f}_r$. The model term evaluates $\mathbf{f}_r$
+with the stress at the beginning of the step, so the yield flags can
+differ from those of the default mode in the cells which yield or
+stop yielding during the step. The kernels get a trace of zero, or
+that of the previous request, so this mode is only for models whose
+$\mathbf{f}_s$ and $\mathbf{f}_r$ do not use the trace. `evp_trA0` is
+the trace where $\lambda = 0$ (set by the model).
+
+Without `EVP_LAZY_DIAGNOSTICS`, `evp_diagnostics()` does nothing: the
+fields are updated by the model term. Consumers call it before
+reading the fields in both modes. A dump written after
+`evp_diagnostics()` holds both fields, so they must be allocated with
+`evp_diagnostics_allocate()` before it is restored.
+
+[burst_evp.c](burst_evp.c) allocates them in `init` for its dumps, and
+its `adapt` event requests them at every step, so there the lazy mode
+saves no memory and no work. It only pays off in setups where no
+consumer asks for the fields. */
+
+double evp_trA0 = 0.;
+#if EVP_LAZY_DIAGNOSTICS
+static bool evp_diag_allocated = false, evp_diag_valid = false;
+
+void evp_diagnostics_allocate()
+{
+  if (!evp_diag_allocated) {
+    trA = new scalar;
+    solidreg = new scalar;
+    evp_diag_allocated = true;
+  }
+}
+
+void evp_diagnostics()
+{
+  if (evp_diag_valid)
+    return;
+  evp_diagnostics_allocate();
+  scalar t = trA;
+  foreach() {
+    if (lambda[] == 0.)
+      t[] = evp_trA0, solidreg[] = -1.;
+    else {
+#if AXI
+      double tqq = tau_qq[];
+#else
+      double tqq = 0.;
+#endif
+      double eta = 1., nu = 1.;
+      if (f_s)
+	f_s (t[], tau_p.x.x[], tau_p.x.y[], tau_p.y.y[], tqq, tau0[], &nu, &eta);
+      double fa = mup[] != 0. ? lambda[]/(mup[]*eta) : 0.;
+      t[] = (fa*(tau_p.x.x[] + tau_p.y.y[]) + 2.)/nu;
+#if AXI
+      t[] += (fa*tqq + 1.)/nu;
+#endif
+      eta = nu = 1.;
+      if (f_r)
+	f_r (t[], tau_p.x.x[], tau_p.x.y[], tau_p.y.y[], tqq, tau0[], &nu, &eta);
+      solidreg[] = eta > solidthresh ? 1. : -1.;
+    }
+  }
+  evp_diag_valid = true;
+}
+#else
+static inline void evp_diagnostics_allocate() {}
+static inline void evp_diagnostics() {}
+#endif
 
 event defaults (i = 0) {
   if (is_constant (a.x))
     a = new face vector;
+#if !EVP_LAZY_DIAGNOSTICS
   if (f_s || f_r) {
     trA = new scalar;
     solidreg = new scalar;
   }
+#endif
 
   foreach() {
     foreach_dimension()
       tau_p.x.x[] = 0.;
     tau_p.x.y[] = 0.;
     
-    foreach_dimension()
-       mytaup.x.x[] = 0.;
-    mytaup.x.y[] = 0.;
+    ref_stress_set (point, 0., 0., 0., 0.);
 
+#if !EVP_LAZY_DIAGNOSTICS
     solidreg[]=0.;
+#endif
 #if AXI
     tau_qq[] = 0;
-    mytauqq[] = 0;
 #endif
   }
 
@@ -261,216 +367,232 @@ event init (i = 0) {
 }
 
 /**
-## Numerical Scheme 
-
-The first step is to implement a routine to calculate the eigenvalues
-and eigenvectors of the conformation tensor $\mathbf{A}$.
+## Numerical Scheme
 
-These structs ressemble Basilisk vectors and tensors but are just
-arrays not related to the grid. */
+The eigen-decomposition of the conformation tensor and the per-cell
+steps (a) and (c) of the split scheme are described in
+[log-conform-kernels.h](log-conform-kernels.h). They work on the
+`pseudo_v` and `pseudo_t` structs, which ressemble Basilisk vectors and
+tensors but are just arrays not related to the grid. */
 
-typedef struct { double x, y;}   pseudo_v;
-typedef struct { pseudo_v x, y;} pseudo_t;
+/**
+The reference stress of the cell is read into one of these. */
 
-static void diagonalization_2D (pseudo_v * Lambda, pseudo_t * R, pseudo_t * A)
+static inline void ref_stress_get (Point point, pseudo_t * T, double * Tqq)
 {
-  /**
-  The eigenvalues are saved in vector $\Lambda$ computed from the
-  trace and the determinant of the symmetric conformation tensor
-  $\mathbf{A}$. */
-
-  if (sq(A->x.y) < 1e-15) {
-    R->x.x = R->y.y = 1.;
-    R->y.x = R->x.y = 0.;
-    Lambda->x = A->x.x; Lambda->y = A->y.y;
-    return;
-  }
-
-  double T = A->x.x + A->y.y; // Trace of the tensor
-  double D = A->x.x*A->y.y - sq(A->x.y); // Determinant
+  T->x.x = mytaup.x.x[], T->y.y = mytaup.y.y[];
+  T->x.y = T->y.x = mytaup.x.y[];
+#if AXI
+  *Tqq = mytauqq[];
+#else
+  *Tqq = 0.;
+#endif
+}
 
-  /**
-  The eigenvectors, $\mathbf{v}_i$ are saved by columns in tensor
-  $\mathbf{R} = (\mathbf{v}_1|\mathbf{v}_2)$. */
-
-  R->x.x = R->x.y = A->x.y;
-  R->y.x = R->y.y = -A->x.x;
-  double s = 1.;
-  for (int i = 0; i < dimension; i++) {
-    double * ev = (double *) Lambda;
-    ev[i] = T/2 + s*sqrt(sq(T)/4. - D);
-    s *= -1;
-    double * Rx = (double *) &R->x;
-    double * Ry = (double *) &R->y;
-    Ry[i] += ev[i];
-    double mod = sqrt(sq(Rx[i]) + sq(Ry[i]));
-    Rx[i] /= mod;
-    Ry[i] /= mod;
-  }
+/**
+### Per-cell kernels
+
+The kernels `upper_convective()` and `model_term()` of
+[log-conform-kernels.h](log-conform-kernels.h) are applied either
+inside `foreach()` or to the packed leaf arrays of
+[leaf-soa.h](leaf-soa.h). Their velocity inputs, the undivided centred
+differences `du` and $u_y/y$, are given by the kernel of
+[velocity-gradient.h](velocity-gradient.h). `upper_convective()` only
+uses them where $\lambda \neq 0$ and `model_term()` only where
+$\lambda = 0$ (the viscous stress), so inside `foreach()` each step
+computes them in its own cells only. The packed evaluation gathers them
+once for both steps, so it keeps them for all the cells. */
+
+static inline void velocity_differences (Point point, pseudo_t * du,
+					 double * uqq)
+{
+  vgrad gu = velocity_gradient (point, u, 1.);
+  du->x.x = gu.xx, du->x.y = gu.xy;
+  du->y.x = gu.yx, du->y.y = gu.yy;
+  *uqq = gu.qq;
 }
 
+#if EVP_SOA
 /**
-The stress tensor depends on previous instants and has to be
-integrated in time. In the log-conformation scheme the advection of
-the stress tensor is circumvented, instead the conformation tensor,
-$\mathbf{A}$ (or more precisely the related variable $\Psi$) is
-advanced in time.
+### Packed evaluation
+
+With `EVP_SOA` the two per-cell steps are not done inside `foreach()`.
+The inputs of all the leaf cells are gathered into the contiguous
+buffers of a [packed leaf view](leaf-soa.h), the kernels run as plain
+loops over these buffers and the results are scattered back to the
+fields. The time spent in each phase is reported at the end of the
+run. */
+
+#include "leaf-soa.h"
+
+enum {
+  SOA_LAMBDA, SOA_MUP, SOA_TAU0, SOA_TRA,          // material
+  SOA_TXX, SOA_TXY, SOA_TYY, SOA_TQQ, SOA_TAUQQ,   // reference stress
+  SOA_DUXX, SOA_DUXY, SOA_DUYX, SOA_DUYY, SOA_UQQ, // velocity gradient
+  SOA_PXX, SOA_PXY, SOA_PYY, SOA_PQQ,              // log-conformation
+  SOA_SXX, SOA_SXY, SOA_SYY, SOA_SQQ,              // new stress
+  SOA_TRAN, SOA_YIELD,
+  SOA_NBUF
+};
+
+static LeafView evp_view;
+
+static void evp_soa_upper_convective()
+{
+  leaf_view_update (&evp_view, SOA_NBUF);
+  double ** b = evp_view.buf;
+  scalar index = evp_view.index;
 
-In what follows we will adopt a scheme similar to that of [Hao \& Pan
-(2007)](#hao2007). We use a split scheme, solving successively
+  timer tm = timer_start();
+  foreach() {
+    int k = index[];
+    pseudo_t T, du;
+    double Tqq, uqq;
+    ref_stress_get (point, &T, &Tqq);
+    velocity_differences (point, &du, &uqq);
+    b[SOA_LAMBDA][k] = lambda[], b[SOA_MUP][k] = mup[];
+    b[SOA_TAU0][k] = tau0[], b[SOA_TRA][k] = trA[];
+    b[SOA_TXX][k] = T.x.x, b[SOA_TXY][k] = T.x.y, b[SOA_TYY][k] = T.y.y;
+    b[SOA_TQQ][k] = Tqq;
+#if AXI
+    b[SOA_TAUQQ][k] = tau_qq[];
+#else
+    b[SOA_TAUQQ][k] = 0.;
+#endif
+    b[SOA_DUXX][k] = du.x.x, b[SOA_DUXY][k] = du.x.y;
+    b[SOA_DUYX][k] = du.y.x, b[SOA_DUYY][k] = du.y.y;
+    b[SOA_UQQ][k] = uqq;
+  }
+  evp_view.gather += timer_elapsed (tm);
+
+  tm = timer_start();
+  int n = evp_view.n;
+  double * Delta = evp_view.Delta;
+  #pragma omp parallel for schedule(static)
+  for (int k = 0; k < n; k++) {
+    pseudo_t T = {{b[SOA_TXX][k], b[SOA_TXY][k]}, {b[SOA_TXY][k], b[SOA_TYY][k]}};
+    pseudo_t du = {{b[SOA_DUXX][k], b[SOA_DUXY][k]},
+		   {b[SOA_DUYX][k], b[SOA_DUYY][k]}};
+    pseudo_t P;
+    double Pqq;
+    upper_convective (b[SOA_LAMBDA][k], b[SOA_MUP][k], b[SOA_TAU0][k],
+		      b[SOA_TRA][k], &T, b[SOA_TQQ][k], b[SOA_TAUQQ][k],
+		      &du, b[SOA_UQQ][k], Delta[k], dt, &P, &Pqq);
+    b[SOA_PXX][k] = P.x.x, b[SOA_PXY][k] = P.x.y, b[SOA_PYY][k] = P.y.y;
+    b[SOA_PQQ][k] = Pqq;
+  }
+  evp_view.kernel += timer_elapsed (tm);
 
-a) the upper convective term:
-$$
-\partial_t \Psi = 2 \mathbf{B} + (\Omega \cdot \Psi -\Psi \cdot \Omega)
-$$
-b) the advection term:
-$$ 
-\partial_t \Psi + \nabla \cdot (\Psi \mathbf{u}) = 0
-$$
-c) the model term (but set in terms of the conformation 
-tensor $\mathbf{A}$). In an Oldroyd-B viscoelastic fluid, the model is
-$$ 
-\partial_t \mathbf{A} = -\frac{\mathbf{f}_r (\mathbf{A})}{\lambda}
-$$
+  tm = timer_start();
+  foreach() {
+    int k = index[];
+    tau_p.x.x[] = b[SOA_PXX][k];
+    tau_p.x.y[] = b[SOA_PXY][k];
+    tau_p.y.y[] = b[SOA_PYY][k];
+#if AXI
+    tau_qq[] = b[SOA_PQQ][k];
+#endif
+  }
+  evp_view.scatter += timer_elapsed (tm);
+}
 
-The implementation below assumes that the values of $\Psi$ and
-$\tau_p$ are never needed simultaneously. This means that $\tau_p$ can
-be used to store (temporarily) the values of $\Psi$ (i.e. $\Psi$ is
-just an alias for $\tau_p$). */
+/**
+The material properties, the reference stress and the velocity
+gradient do not change during the advection of $\Psi$, so only $\Psi$
+needs to be gathered again for the model term. */
 
-event tracer_advection (i++)
+static void evp_soa_model_term()
 {
-  tensor Psi = tau_p;
+  double ** b = evp_view.buf;
+  scalar index = evp_view.index;
+
+  timer tm = timer_start();
+  foreach() {
+    int k = index[];
+    b[SOA_PXX][k] = tau_p.x.x[];
+    b[SOA_PXY][k] = tau_p.x.y[];
+    b[SOA_PYY][k] = tau_p.y.y[];
 #if AXI
-  scalar Psiqq = tau_qq;
+    b[SOA_PQQ][k] = tau_qq[];
+#else
+    b[SOA_PQQ][k] = 0.;
 #endif
+  }
+  evp_view.gather += timer_elapsed (tm);
+
+  tm = timer_start();
+  int n = evp_view.n;
+  double * Delta = evp_view.Delta;
+  #pragma omp parallel for schedule(static)
+  for (int k = 0; k < n; k++) {
+    pseudo_t T = {{b[SOA_TXX][k], b[SOA_TXY][k]}, {b[SOA_TXY][k], b[SOA_TYY][k]}};
+    pseudo_t du = {{b[SOA_DUXX][k], b[SOA_DUXY][k]},
+		   {b[SOA_DUYX][k], b[SOA_DUYY][k]}};
+    pseudo_t P = {{b[SOA_PXX][k], b[SOA_PXY][k]}, {b[SOA_PXY][k], b[SOA_PYY][k]}};
+    pseudo_t S;
+    model_term (b[SOA_LAMBDA][k], b[SOA_MUP][k], b[SOA_TAU0][k], b[SOA_TRA][k],
+		&T, b[SOA_TQQ][k], &P, b[SOA_PQQ][k],
+		&du, b[SOA_UQQ][k], Delta[k], dt,
+		&S, &b[SOA_SQQ][k], &b[SOA_TRAN][k], &b[SOA_YIELD][k]);
+    b[SOA_SXX][k] = S.x.x, b[SOA_SXY][k] = S.x.y, b[SOA_SYY][k] = S.y.y;
+  }
+  evp_view.kernel += timer_elapsed (tm);
 
-  /**
-  ### Computation of $\Psi = \log \mathbf{A}$ and upper convective term */
-
+  tm = timer_start();
   foreach() {
-    if (lambda[] == 0.) {
-      foreach_dimension()
-	     Psi.x.x[] = 0.;
-      Psi.x.y[] = 0.;
+    int k = index[];
+    tau_p.x.x[] = b[SOA_SXX][k];
+    tau_p.x.y[] = b[SOA_SXY][k];
+    tau_p.y.y[] = b[SOA_SYY][k];
 #if AXI
-      Psiqq[] = 0.;
+    tau_qq[] = b[SOA_SQQ][k];
 #endif
+#if !EVP_LAZY_DIAGNOSTICS
+    if (f_s || f_r) {
+      scalar t = trA;
+      t[] = b[SOA_TRAN][k];
     }
-    else { // lambda[] != 0.
-
-      /**
-      We assume that the stress tensor $\mathbf{\tau}_p$ depends on the
-      conformation tensor $\mathbf{A}$ as follows
-      $$
-      \mathbf{\tau}_p = \frac{\mu_p}{\lambda} f_s (\mathbf{A}) = 
-      \frac{\mu_p}{\lambda} \eta (\nu \mathbf{A} - I)
-      $$
-      In most of the viscoelastic models, $\nu$ and $\eta$ are 
-      nonlinear parameters that depend on the trace of the conformation tensor,
-      $\mathbf{A}$.*/
-
-      double eta = 1., nu = 1.;
-      if (f_s)
-	     f_s (trA[], mytaup.x.x[], mytaup.x.y[], mytaup.y.y[], mytauqq[], tau0[], &nu, &eta);
-
-      double fa = (mup[] != 0 ? lambda[]/(mup[]*eta) : 0.);
-
-      pseudo_t A;
-      A.x.y = fa*mytaup.x.y[]/nu;
-      foreach_dimension()
-	     A.x.x = (fa*mytaup.x.x[] + 1.)/nu;
+    solidreg[] = b[SOA_YIELD][k];
+#endif
+    ref_stress_set (point, b[SOA_SXX][k], b[SOA_SXY][k], b[SOA_SYY][k],
+		    b[SOA_SQQ][k]);
+  }
+  evp_view.scatter += timer_elapsed (tm);
+}
 
-      /**
-      In the axisymmetric case, $\Psi_{\theta \theta} = \log A_{\theta
-      \theta}$. Therefore $\Psi_{\theta \theta} = \log [ ( 1 + fa 
-      \tau_p_{\theta \theta})/\nu]$. */
+event end (t = end)
+{
+  leaf_view_report (&evp_view, "log-conformation", ferr);
+  leaf_view_free (&evp_view);
+}
+#endif // EVP_SOA
 
+event tracer_advection (i++)
+{
+  tensor Psi = tau_p;
 #if AXI
-      double Aqq = (1. + fa*tau_qq[])/nu;
-      Psiqq[] = log (Aqq); 
+  scalar Psiqq = tau_qq;
+#else
+  scalar Psiqq = zeroc;
 #endif
 
-      /**
-      The conformation tensor is diagonalized through the
-      eigenvector tensor $\mathbf{R}$ and the eigenvalues diagonal
-      tensor, $\Lambda$. */
-
-      pseudo_v Lambda;
-      pseudo_t R;
-      diagonalization_2D (&Lambda, &R, &A);
-      
-      /**
-      $\Psi = \log \mathbf{A}$ is easily obtained after diagonalization, 
-      $\Psi = R \cdot \log(\Lambda) \cdot R^T$. */
-      
-      Psi.x.y[] = R.x.x*R.y.x*log(Lambda.x) + R.y.y*R.x.y*log(Lambda.y);
-      foreach_dimension()
-	     Psi.x.x[] = sq(R.x.x)*log(Lambda.x) + sq(R.x.y)*log(Lambda.y);
-      
-      /**
-      We now compute the upper convective term $2 \mathbf{B} +
-      (\Omega \cdot \Psi -\Psi \cdot \Omega)$.
-	
-      The diagonalization will be applied to the velocity gradient
-      $(\nabla u)^T$ to obtain the antisymmetric tensor $\Omega$ and
-      the traceless, symmetric tensor, $\mathbf{B}$. If the conformation
-      tensor is $\mathbf{I}$, $\Omega = 0$ and $\mathbf{B}= \mathbf{D}$.  */
-
-      pseudo_t B;
-      double OM = 0.;
-      if (fabs(Lambda.x - Lambda.y) <= 1e-20) {
-	B.x.y = (u.y[1,0] - u.y[-1,0] +
-		 u.x[0,1] - u.x[0,-1])/(4.*Delta); 
-	foreach_dimension() 
-	   B.x.x = (u.x[1,0] - u.x[-1,0])/(2.*Delta);
-      }
-      else {
-	pseudo_t M;
-	foreach_dimension() {
-	  M.x.x = (sq(R.x.x)*(u.x[1] - u.x[-1]) +
-		   sq(R.y.x)*(u.y[0,1] - u.y[0,-1]) +
-		   R.x.x*R.y.x*(u.x[0,1] - u.x[0,-1] + 
-				u.y[1] - u.y[-1]))/(2.*Delta);
-	  M.x.y = (R.x.x*R.x.y*(u.x[1] - u.x[-1]) + 
-		   R.x.y*R.y.x*(u.y[1] - u.y[-1]) +
-		   R.x.x*R.y.y*(u.x[0,1] - u.x[0,-1]) +
-		   R.y.x*R.y.y*(u.y[0,1] - u.y[0,-1]))/(2.*Delta);
-	}
-	double omega = (Lambda.y*M.x.y + Lambda.x*M.y.x)/(Lambda.y - Lambda.x);
-	OM = (R.x.x*R.y.y - R.x.y*R.y.x)*omega;
-	
-	B.x.y = M.x.x*R.x.x*R.y.x + M.y.y*R.y.y*R.x.y;
-	foreach_dimension()
-	   B.x.x = M.x.x*sq(R.x.x)+M.y.y*sq(R.x.y);
-      }
-
-      /**
-      We now advance $\Psi$ in time, adding the upper convective
-      contribution. */
-
-      double s = - Psi.x.y[];
-      Psi.x.y[] += dt*(2.*B.x.y + OM*(Psi.y.y[] - Psi.x.x[]));
-      foreach_dimension() {
-	     s *= -1;
-	     Psi.x.x[] += dt*2.*(B.x.x + s*OM);
-      }
-
-      /**
-      In the axisymmetric case, the governing equation for $\Psi_{\theta
-      \theta}$ only involves that component, 
-      $$ 
-      \Psi_{\theta \theta}|_t - 2 L_{\theta \theta} = 
-      \frac{\mathbf{f}_r(e^{-\Psi_{\theta \theta}})}{\lambda} 
-      $$
-      with $L_{\theta \theta} = u_y/y$. Therefore step (a) for
-      $\Psi_{\theta \theta}$ is */
-
+#if EVP_SOA
+  evp_soa_upper_convective();
+#else
+  foreach() {
+    pseudo_t T, du = {{0}}, P;
+    double Tqq, Pqq, uqq = 0.;
+    ref_stress_get (point, &T, &Tqq);
+    if (lambda[] != 0.)
+      velocity_differences (point, &du, &uqq);
+    upper_convective (lambda[], mup[], tau0[], trA[], &T, Tqq, Psiqq[],
+		      &du, uqq, Delta, dt, &P, &Pqq);
+    Psi.x.x[] = P.x.x, Psi.x.y[] = P.x.y, Psi.y.y[] = P.y.y;
 #if AXI
-      Psiqq[] += dt*2.*u.y[]/y;
+    Psiqq[] = Pqq;
 #endif
-    }
   }
+#endif // !EVP_SOA
   
   /**
   ### Advection of $\Psi$
@@ -489,141 +611,37 @@ event tracer_advection (i++)
 
   /**
   ### Model term */
-  
-  foreach() {
-    if (lambda[] == 0.) {
-
-      /**
-      If $\lambda = 0$ the stress tensor for the polymeric part
-      reduces to that of a Newtonian fluid $\mathbf{\tau}_p = 2 \mu_p
-      \mathbf{D}$ with $\mathbf{D}$ the rate-of-strain
-      tensor. Note that $\mathbf{\tau}_p$ is in this case independent of
-      time. */
-
-      foreach_dimension()
-	     tau_p.x.x[] = mup[]*(u.x[1,0] - u.x[-1,0])/Delta; // 2*mu*dxu;
-      tau_p.x.y[] = mup[]*(u.y[1,0] - u.y[-1,0] +
-			   u.x[0,1] - u.x[0,-1])/(2.*Delta); // mu*(dxv+dyu)
-      foreach_dimension()	
-         mytaup.x.x[] = tau_p.x.x[];
-      mytaup.x.y[] = tau_p.x.y[];
-
-      solidreg[] = -1.0;  // Indicates un-yielded
 
+#if EVP_SOA
+  evp_soa_model_term();
+#else
+  foreach() {
+    pseudo_t T, du = {{0}}, tau;
+    pseudo_t P = {{Psi.x.x[], Psi.x.y[]}, {Psi.y.x[], Psi.y.y[]}};
+    double Tqq, tauqq, trAn, yielded, uqq = 0.;
+    ref_stress_get (point, &T, &Tqq);
+    if (lambda[] == 0.)
+      velocity_differences (point, &du, &uqq);
+    model_term (lambda[], mup[], tau0[], trA[], &T, Tqq, &P, Psiqq[],
+		&du, uqq, Delta, dt,
+		&tau, &tauqq, &trAn, &yielded);
+    tau_p.x.x[] = tau.x.x, tau_p.x.y[] = tau.x.y, tau_p.y.y[] = tau.y.y;
 #if AXI
-      tau_qq[] = 2.*mup[]*u.y[]/y;
-      mytauqq[] = tau_qq[];
+    tau_qq[] = tauqq;
 #endif
+#if !EVP_LAZY_DIAGNOSTICS
+    if (f_s || f_r) {
+      scalar t = trA;
+      t[] = trAn;
     }
-    else { // lambda != 0.
-      
-      /**
-      It is time to undo the log-conformation, again by
-      diagonalization, to recover the conformation tensor $\mathbf{A}$
-      and to perform step (c).*/
-
-      pseudo_t A = {{Psi.x.x[], Psi.x.y[]}, {Psi.y.x[], Psi.y.y[]}}, R;
-      pseudo_v Lambda;
-      diagonalization_2D (&Lambda, &R, &A);
-      Lambda.x = exp(Lambda.x), Lambda.y = exp(Lambda.y);
-      
-      A.x.y = R.x.x*R.y.x*Lambda.x + R.y.y*R.x.y*Lambda.y;
-      foreach_dimension()
-	     A.x.x = sq(R.x.x)*Lambda.x + sq(R.x.y)*Lambda.y;
-#if AXI
-      double Aqq = exp(Psiqq[]);
-#endif
-
-      /**
-      We perform now step (c) by integrating 
-      $\mathbf{A}_t = -\mathbf{f}_r (\mathbf{A})/\lambda$ to obtain
-      $\mathbf{A}^{n+1}$. This step is analytic,
-      $$
-      \int_{t^n}^{t^{n+1}}\frac{d \mathbf{A}}{\mathbf{I}- \nu \mathbf{A}} = 
-      \frac{\eta \, \Delta t}{\lambda}
-      $$
-      */
-
-      double eta = 1., nu = 1.;
-      if (f_r) {
-#if 0 // Set to one if the midstep trace is to be used.
-	scalar t = trA;
-	t[] = A.x.x + A.y.y;
-#if AXI
-	t[] += Aqq;
+    solidreg[] = yielded;
 #endif
-#endif
-
-      f_r (trA[], mytaup.x.x[], mytaup.x.y[], mytaup.y.y[], mytauqq[], tau0[], &nu, &eta);
-      }
-
-      if (eta > solidthresh) {
-          solidreg[]=1.0; // Yielded region
-      }
-      else { 
-          solidreg[]=-1.0;
-      }
-
-//// EVP non-exponential version      
-//      double fa =eta*dt/lambda[];
-//
-//      A.x.y= A.x.y -fa*A.x.y;
-//      foreach_dimension()
-//	A.x.x = A.x.x-fa*(A.x.x-1.0);
-
-//EVP exponential version
-       double fa = exp(-eta*dt/lambda[]);
-  
-      A.x.y= fa*A.x.y;
-      foreach_dimension()
-         A.x.x = fa*(A.x.x-1.0)+1.0;
-    	
-
-#if AXI
-      Aqq = fa*(Aqq-1.0)+1.0;
-      Psiqq[] = log (Aqq);
-#endif
-
-      /**
-      The trace at time $n+1$ is also needed for some models. */
-      
-      if (f_s || f_r) {
-	scalar t = trA;
-	t[] = A.x.x + A.y.y;
-#if AXI
-	t[] += Aqq;
-#endif
-      }
-
-      /**
-      Then the stress tensor $\mathbf{\tau}_p^{n+1}$ is computed from
-      $\mathbf{A}^{n+1}$ according to the constitutive model,
-      $\mathbf{f}_s(\mathbf{A})$.  */
-
-      nu = 1; eta = 1.;
-      if (f_s)
-         f_s (trA[], mytaup.x.x[], mytaup.x.y[], mytaup.y.y[], mytauqq[], tau0[], &nu, &eta);
-
-      fa = mup[]/lambda[]*eta;
-      
-      tau_p.x.y[] = fa*nu*A.x.y;
-#if AXI
-      tau_qq[] = fa*(nu*Aqq - 1.);
-#endif
-      foreach_dimension()
-	     tau_p.x.x[] = fa*(nu*A.x.x - 1.);
-	     
-      scalar tt = mytaup.x.x;
-      scalar ttt = mytaup.x.y;
-      scalar tttt = mytaup.y.y;
-      scalar ttttt = mytauqq;
-      tt[] = tau_p.x.x[];
-      ttt[] = tau_p.x.y[];
-      tttt[] = tau_p.y.y[];
-      ttttt[] = tau_qq[];
-
-    }
+    ref_stress_set (point, tau.x.x, tau.x.y, tau.y.y, tauqq);
   }
+#endif // !EVP_SOA
+#if EVP_LAZY_DIAGNOSTICS
+  evp_diag_valid = false;
+#endif
 
 #if AXI
   boundary((scalar *){tau_p, tau_qq, mytaup, mytauqq});
@@ -0,0 +1,350 @@
+/**
+# Per-cell kernels of the log-conformation scheme
+
+The eigen-decomposition of the conformation tensor and the two per-cell
+steps of the scheme of [log-conform-EVP.h](log-conform-EVP.h): the
+computation of $\Psi = \log \mathbf{A}$ with the upper convective
+term, and the model term (exponential relaxation). They only use plain
+values, with no access to the grid. The same code is therefore used
+inside `foreach()`, on the packed leaf arrays of
+[leaf-soa.h](leaf-soa.h), and on plain arrays by
+[kernel-bench.c](kernel-bench.c), which compiles this file with a
+plain C compiler. `AXI` selects the axisymmetric version, as in
+Basilisk.
+
+`T` and `Tqq` are the reference stress (at the beginning of the step),
+`du` the undivided centred differences of the velocity (`du.x.y` is
+$u_x[0,1] - u_x[0,-1]$) and `uqq` is $u_y/y$. */
+
+#ifndef sq
+# define sq(x) ((x)*(x))
+#endif
+
+/**
+The constitutive functions $\mathbf{f}_s$ and $\mathbf{f}_r$ (see
+[log-conform-EVP.h](log-conform-EVP.h)); Oldroyd-B if they are not
+set. */
+
+void (* f_s) (double, double, double, double, double, double, double *, double *) = NULL;
+void (* f_r) (double, double, double, double, double, double, double *, double *) = NULL;
+
+double solidthresh=1e-4; // Yield-surface is plotted when K > solidthresh, where K is the switch-term; One could essentially set this to 0 to 0.001 (threshold value for refinement)
+
+/**
+## Eigen-decomposition
+
+The first step is to implement a routine to calculate the eigenvalues
+and eigenvectors of the conformation tensor $\mathbf{A}$.
+
+These structs ressemble Basilisk vectors and tensors but are just
+arrays not related to the grid. */
+
+typedef struct { double x, y;}   pseudo_v;
+typedef struct { pseudo_v x, y;} pseudo_t;
+
+static void diagonalization_2D (pseudo_v * Lambda, pseudo_t * R, pseudo_t * A)
+{
+  /**
+  The eigenvalues are saved in vector $\Lambda$ computed from the
+  trace and the determinant of the symmetric conformation tensor
+  $\mathbf{A}$. */
+
+  if (sq(A->x.y) < 1e-15) {
+    R->x.x = R->y.y = 1.;
+    R->y.x = R->x.y = 0.;
+    Lambda->x = A->x.x; Lambda->y = A->y.y;
+    return;
+  }
+
+  double T = A->x.x + A->y.y; // Trace of the tensor
+  double D = A->x.x*A->y.y - sq(A->x.y); // Determinant
+
+  /**
+  The eigenvectors, $\mathbf{v}_i$ are saved by columns in tensor
+  $\mathbf{R} = (\mathbf{v}_1|\mathbf{v}_2)$. */
+
+  R->x.x = R->x.y = A->x.y;
+  R->y.x = R->y.y = -A->x.x;
+  double s = 1.;
+  for (int i = 0; i < 2; i++) {
+    double * ev = (double *) Lambda;
+    ev[i] = T/2 + s*sqrt(sq(T)/4. - D);
+    s *= -1;
+    double * Rx = (double *) &R->x;
+    double * Ry = (double *) &R->y;
+    Ry[i] += ev[i];
+    double mod = sqrt(sq(Rx[i]) + sq(Ry[i]));
+    Rx[i] /= mod;
+    Ry[i] /= mod;
+  }
+}
+
+/**
+The stress tensor depends on previous instants and has to be
+integrated in time. In the log-conformation scheme the advection of
+the stress tensor is circumvented, instead the conformation tensor,
+$\mathbf{A}$ (or more precisely the related variable $\Psi$) is
+advanced in time.
+
+In what follows we will adopt a scheme similar to that of [Hao \& Pan
+(2007)](#hao2007). We use a split scheme, solving successively
+
+a) the upper convective term:
+$$
+\partial_t \Psi = 2 \mathbf{B} + (\Omega \cdot \Psi -\Psi \cdot \Omega)
+$$
+b) the advection term:
+$$ 
+\partial_t \Psi + \nabla \cdot (\Psi \mathbf{u}) = 0
+$$
+c) the model term (but set in terms of the conformation 
+tensor $\mathbf{A}$). In an Oldroyd-B viscoelastic fluid, the model is
+$$ 
+\partial_t \mathbf{A} = -\frac{\mathbf{f}_r (\mathbf{A})}{\lambda}
+$$
+
+The implementation below assumes that the values of $\Psi$ and
+$\tau_p$ are never needed simultaneously. This means that $\tau_p$ can
+be used to store (temporarily) the values of $\Psi$ (i.e. $\Psi$ is
+just an alias for $\tau_p$). */
+
+/**
+## Computation of $\Psi = \log \mathbf{A}$ and upper convective term */
+
+static void upper_convective (double lambda, double mup, double tau0,
+			      double trA, const pseudo_t * T, double Tqq,
+			      double tqq, const pseudo_t * du, double uqq,
+			      double Delta, double dt,
+			      pseudo_t * Psi, double * Psiqq)
+{
+  if (lambda == 0.) {
+    Psi->x.x = Psi->x.y = Psi->y.x = Psi->y.y = 0.;
+    *Psiqq = 0.;
+    return;
+  }
+
+  /**
+  We assume that the stress tensor $\mathbf{\tau}_p$ depends on the
+  conformation tensor $\mathbf{A}$ as follows
+  $$
+  \mathbf{\tau}_p = \frac{\mu_p}{\lambda} f_s (\mathbf{A}) = 
+  \frac{\mu_p}{\lambda} \eta (\nu \mathbf{A} - I)
+  $$
+  In most of the viscoelastic models, $\nu$ and $\eta$ are 
+  nonlinear parameters that depend on the trace of the conformation tensor,
+  $\mathbf{A}$.*/
+
+  double eta = 1., nu = 1.;
+  if (f_s)
+    f_s (trA, T->x.x, T->x.y, T->y.y, Tqq, tau0, &nu, &eta);
+
+  double fa = (mup != 0 ? lambda/(mup*eta) : 0.);
+
+  pseudo_t A;
+  A.x.y = A.y.x = fa*T->x.y/nu;
+  A.x.x = (fa*T->x.x + 1.)/nu;
+  A.y.y = (fa*T->y.y + 1.)/nu;
+
+  /**
+  In the axisymmetric case, $\Psi_{\theta \theta} = \log A_{\theta
+  \theta}$. Therefore $\Psi_{\theta \theta} = \log [ ( 1 + fa 
+  \tau_p_{\theta \theta})/\nu]$. */
+
+#if AXI
+  double Aqq = (1. + fa*tqq)/nu;
+  *Psiqq = log (Aqq); 
+#endif
+
+  /**
+  The conformation tensor is diagonalized through the
+  eigenvector tensor $\mathbf{R}$ and the eigenvalues diagonal
+  tensor, $\Lambda$. */
+
+  pseudo_v Lambda;
+  pseudo_t R;
+  diagonalization_2D (&Lambda, &R, &A);
+      
+  /**
+  $\Psi = \log \mathbf{A}$ is easily obtained after diagonalization, 
+  $\Psi = R \cdot \log(\Lambda) \cdot R^T$. */
+      
+  Psi->x.y = R.x.x*R.y.x*log(Lambda.x) + R.y.y*R.x.y*log(Lambda.y);
+  Psi->x.x = sq(R.x.x)*log(Lambda.x) + sq(R.x.y)*log(Lambda.y);
+  Psi->y.y = sq(R.y.y)*log(Lambda.y) + sq(R.y.x)*log(Lambda.x);
+      
+  /**
+  We now compute the upper convective term $2 \mathbf{B} +
+  (\Omega \cdot \Psi -\Psi \cdot \Omega)$.
+	
+  The diagonalization will be applied to the velocity gradient
+  $(\nabla u)^T$ to obtain the antisymmetric tensor $\Omega$ and
+  the traceless, symmetric tensor, $\mathbf{B}$. If the conformation
+  tensor is $\mathbf{I}$, $\Omega = 0$ and $\mathbf{B}= \mathbf{D}$.  */
+
+  pseudo_t B;
+  double OM = 0.;
+  if (fabs(Lambda.x - Lambda.y) <= 1e-20) {
+    B.x.y = (du->y.x + du->x.y)/(4.*Delta); 
+    B.x.x = du->x.x/(2.*Delta);
+    B.y.y = du->y.y/(2.*Delta);
+  }
+  else {
+    pseudo_t M;
+    M.x.x = (sq(R.x.x)*du->x.x + sq(R.y.x)*du->y.y +
+	     R.x.x*R.y.x*(du->x.y + du->y.x))/(2.*Delta);
+    M.y.y = (sq(R.y.y)*du->y.y + sq(R.x.y)*du->x.x +
+	     R.y.y*R.x.y*(du->y.x + du->x.y))/(2.*Delta);
+    M.x.y = (R.x.x*R.x.y*du->x.x + R.x.y*R.y.x*du->y.x +
+	     R.x.x*R.y.y*du->x.y + R.y.x*R.y.y*du->y.y)/(2.*Delta);
+    M.y.x = (R.y.y*R.y.x*du->y.y + R.y.x*R.x.y*du->x.y +
+	     R.y.y*R.x.x*du->y.x + R.x.y*R.x.x*du->x.x)/(2.*Delta);
+    double omega = (Lambda.y*M.x.y + Lambda.x*M.y.x)/(Lambda.y - Lambda.x);
+    OM = (R.x.x*R.y.y - R.x.y*R.y.x)*omega;
+	
+    B.x.y = M.x.x*R.x.x*R.y.x + M.y.y*R.y.y*R.x.y;
+    B.x.x = M.x.x*sq(R.x.x) + M.y.y*sq(R.x.y);
+    B.y.y = M.y.y*sq(R.y.y) + M.x.x*sq(R.y.x);
+  }
+
+  /**
+  We now advance $\Psi$ in time, adding the upper convective
+  contribution. */
+
+  double s = Psi->x.y;
+  Psi->x.y += dt*(2.*B.x.y + OM*(Psi->y.y - Psi->x.x));
+  Psi->y.x = Psi->x.y;
+  Psi->x.x += dt*2.*(B.x.x + s*OM);
+  Psi->y.y += dt*2.*(B.y.y - s*OM);
+
+  /**
+  In the axisymmetric case, the governing equation for $\Psi_{\theta
+  \theta}$ only involves that component, 
+  $$ 
+  \Psi_{\theta \theta}|_t - 2 L_{\theta \theta} = 
+  \frac{\mathbf{f}_r(e^{-\Psi_{\theta \theta}})}{\lambda} 
+  $$
+  with $L_{\theta \theta} = u_y/y$. Therefore step (a) for
+  $\Psi_{\theta \theta}$ is */
+
+#if AXI
+  *Psiqq += dt*2.*uqq;
+#endif
+}
+
+/**
+## Model term */
+
+static void model_term (double lambda, double mup, double tau0, double trA,
+			const pseudo_t * T, double Tqq,
+			const pseudo_t * Psi, double Psiqq,
+			const pseudo_t * du, double uqq, double Delta, double dt,
+			pseudo_t * tau, double * tauqq, double * trAn,
+			double * yielded)
+{
+  if (lambda == 0.) {
+
+    /**
+    If $\lambda = 0$ the stress tensor for the polymeric part
+    reduces to that of a Newtonian fluid $\mathbf{\tau}_p = 2 \mu_p
+    \mathbf{D}$ with $\mathbf{D}$ the rate-of-strain
+    tensor. Note that $\mathbf{\tau}_p$ is in this case independent of
+    time. */
+
+    tau->x.x = mup*du->x.x/Delta; // 2*mu*dxu;
+    tau->y.y = mup*du->y.y/Delta;
+    tau->x.y = tau->y.x = mup*(du->y.x + du->x.y)/(2.*Delta); // mu*(dxv+dyu)
+    *tauqq = 2.*mup*uqq;
+    *trAn = trA;
+    *yielded = -1.0;  // Indicates un-yielded
+    return;
+  }
+      
+  /**
+  It is time to undo the log-conformation, again by
+  diagonalization, to recover the conformation tensor $\mathbf{A}$
+  and to perform step (c).*/
+
+  pseudo_t A = *Psi, R;
+  pseudo_v Lambda;
+  diagonalization_2D (&Lambda, &R, &A);
+  Lambda.x = exp(Lambda.x), Lambda.y = exp(Lambda.y);
+      
+  A.x.y = R.x.x*R.y.x*Lambda.x + R.y.y*R.x.y*Lambda.y;
+  A.x.x = sq(R.x.x)*Lambda.x + sq(R.x.y)*Lambda.y;
+  A.y.y = sq(R.y.y)*Lambda.y + sq(R.y.x)*Lambda.x;
+  double Aqq = exp(Psiqq);
+
+  /**
+  We perform now step (c) by integrating 
+  $\mathbf{A}_t = -\mathbf{f}_r (\mathbf{A})/\lambda$ to obtain
+  $\mathbf{A}^{n+1}$. This step is analytic,
+  $$
+  \int_{t^n}^{t^{n+1}}\frac{d \mathbf{A}}{\mathbf{I}- \nu \mathbf{A}} = 
+  \frac{\eta \, \Delta t}{\lambda}
+  $$
+  */
+
+  double eta = 1., nu = 1.;
+  if (f_r)
+    f_r (trA, T->x.x, T->x.y, T->y.y, Tqq, tau0, &nu, &eta);
+
+  *yielded = eta > solidthresh ? 1.0 : -1.0; // Yielded region
+
+//// EVP non-exponential version      
+//  double fa = eta*dt/lambda;
+//
+//  A.x.y = A.x.y - fa*A.x.y;
+//  foreach_dimension()
+//    A.x.x = A.x.x - fa*(A.x.x - 1.0);
+
+//EVP exponential version
+  double fa = exp(-eta*dt/lambda);
+  
+  A.x.y = fa*A.x.y;
+  A.x.x = fa*(A.x.x - 1.0) + 1.0;
+  A.y.y = fa*(A.y.y - 1.0) + 1.0;
+  Aqq = fa*(Aqq - 1.0) + 1.0;
+
+  /**
+  The trace at time $n+1$ is also needed for some models. */
+
+  *trAn = trA;
+  if (f_s || f_r) {
+    *trAn = A.x.x + A.y.y;
+#if AXI
+    *trAn += Aqq;
+#endif
+  }
+
+  /**
+  Then the stress tensor $\mathbf{\tau}_p^{n+1}$ is computed from
+  $\mathbf{A}^{n+1}$ according to the constitutive model,
+  $\mathbf{f}_s(\mathbf{A})$.  */
+
+  nu = 1; eta = 1.;
+  if (f_s)
+    f_s (*trAn, T->x.x, T->x.y, T->y.y, Tqq, tau0, &nu, &eta);
+
+  fa = mup/lambda*eta;
+      
+  tau->x.y = tau->y.x = fa*nu*A.x.y;
+  *tauqq = fa*(nu*Aqq - 1.);
+  tau->x.x = fa*(nu*A.x.x - 1.);
+  tau->y.y = fa*(nu*A.y.y - 1.);
+}
+
+/**
+## Recorded inputs
+
+The inputs of both kernels in one cell, as written by
+[record-kernel-inputs.c](record-kernel-inputs.c) after the magic
+`EVPKIN01` and the number of records (int32). */
+
+#define KERNEL_INPUT_MAGIC "EVPKIN01"
+
+typedef struct {
+  double lambda, mup, tau0, trA;
+  double Txx, Txy, Tyy, Tqq, tqq;   // reference stress, tau_qq
+  double duxx, duxy, duyx, duyy, uqq;
+  double Delta, dt;
+} KernelInput;
@@ -0,0 +1,174 @@
+/**
+# Memory accounting
+
+Basilisk stores the fields of the tree cell by cell: every cell holds
+one double for each slot of `datasize`, whatever its level. A slot is
+added for every field created, including the temporary fields of the
+events (e.g. those of the `adapt` event of
+[burst_evp.c](burst_evp.c)). The slots of deleted temporaries are
+reused by later ones but never given back, so the memory of a cell is
+set by the largest number of fields alive at the same time.
+
+Every field costs the same: a component of a face vector is one slot
+of the cell on its left, and a `nodump` field is allocated like any
+other. A field which is never allocated (e.g. `trA` and `solidreg`
+with `-DEVP_LAZY_DIAGNOSTICS=1` until a consumer asks for them) has no
+slot. The bytes of a group of fields are therefore its number of
+fields times the number of cells times `sizeof(double)`.
+
+At the first step (after the initial refinement and the first
+adaptation) and at the end of the run, a report is printed on
+standard error with
+
+- the number of cells and the bytes of each level (data and cell
+  header),
+- the fields and bytes of each group of fields: `flow` (the
+  Navier--Stokes and VOF fields), `stress` (the polymeric stress and
+  its reference copy, see [log-conform-EVP.h](log-conform-EVP.h)),
+  `material` (`mupv`, `lambdav`, `tau0v`), `diagnostic` (`trA`,
+  `solidreg`), `other` (caches, numberings) and `free`, the slots left
+  by deleted temporaries,
+- the resident memory of the process, which also holds the halo cells,
+  the tree structure and the buffers.
+
+After each adaptation which changed the mesh (see `adapt_generation`
+in [adapt_wavelet_limited.h](adapt_wavelet_limited.h)), one line
+
+~~~
+i t leaves cells slots fields bytes rss n0 n1 ...
+~~~
+
+is appended to `memory`, with `n<l>` the number of cells of level
+`l`, from 0 to the depth of the tree at that step. The leaf cells of
+each level are counted in one parallel traversal and the cells of the
+upper levels follow, since every refined cell has $2^d$ children. This
+is done at every step by default (the `adapt` event of `burst_evp.c`
+runs at every step); `memory_every` checks for a new line only every
+`memory_every` steps instead. The full report is appended to
+`memory-fields` each time the number of slots grows. */
+
+int memory_every = 1;           // steps between two checks of the mesh (0: no `memory`)
+
+static const char * memory_group (const char * name)
+{
+  static const struct { const char * prefix, * group; } g[] = {
+    {"u.", "flow"}, {"uf.", "flow"}, {"g.", "flow"}, {"fm.", "flow"},
+    {"alphav.", "flow"}, {"a.", "flow"}, {"p", "flow"}, {"pf", "flow"},
+    {"f", "flow"}, {"cm", "flow"}, {"rhov", "flow"},
+    {"tau_p.", "stress"}, {"tau_qq", "stress"}, {"mytaup.", "stress"},
+    {"mytauqq", "stress"},
+    {"mupv", "material"}, {"lambdav", "material"}, {"tau0v", "material"},
+    {"trA", "diagnostic"}, {"solidreg", "diagnostic"},
+    {NULL}
+  };
+  for (int k = 0; g[k].prefix; k++) {
+    int n = strlen (g[k].prefix);
+    if (g[k].prefix[n - 1] == '.' ? !strncmp (name, g[k].prefix, n) :
+	!strcmp (name, g[k].prefix))
+      return g[k].group;
+  }
+  return "other";
+}
+
+static long memory_rss()
+{
+  long pages = 0, rss = 0;
+  FILE * fp = fopen ("/proc/self/statm", "r");
+  if (fp) {
+    if (fscanf (fp, "%ld %ld", &pages, &rss) != 2)
+      rss = 0;
+    fclose (fp);
+  }
+  return rss*sysconf (_SC_PAGESIZE);
+}
+
+#define MEMORY_MAXLEVEL 32
+
+typedef struct {
+  long leaves, cells, level[MEMORY_MAXLEVEL];
+  int depth, slots, fields;
+} MemoryCount;
+
+static MemoryCount memory_count()
+{
+  MemoryCount m = {0};
+  m.depth = min (depth(), MEMORY_MAXLEVEL - 1);
+  long leaves[MEMORY_MAXLEVEL] = {0};
+  foreach (reduction(+:leaves[:MEMORY_MAXLEVEL]))
+    leaves[min (level, MEMORY_MAXLEVEL - 1)]++;
+  for (int l = m.depth; l >= 0; l--) {
+    m.level[l] = leaves[l] + (l < m.depth ? m.level[l + 1]/(1 << dimension) : 0);
+    m.leaves += leaves[l], m.cells += m.level[l];
+  }
+  m.slots = datasize/sizeof(double);
+  for (scalar s in all)
+    m.fields++;
+  return m;
+}
+
+void memory_report (FILE * fp)
+{
+  MemoryCount m = memory_count();
+  double field = sizeof(double)*(double) m.cells;
+  fprintf (fp, "# memory at i = %d, t = %g: %ld leaf cells, %ld cells, "
+	   "%d slots of %ld bytes, %ld bytes of cell header\n",
+	   i, t, m.leaves, m.cells, m.slots, (long) sizeof(double),
+	   (long) sizeof(Cell));
+  fprintf (fp, "# level cells bytes\n");
+  for (int l = 0; l <= m.depth; l++)
+    if (m.level[l])
+      fprintf (fp, "%d %ld %.4g\n", l, m.level[l],
+	       (double) m.level[l]*(datasize + sizeof(Cell)));
+
+  fprintf (fp, "# group fields bytes names (%.4g bytes per field)\n", field);
+  const char * groups[] = {"flow", "stress", "material", "diagnostic",
+			   "other", "free"};
+  for (int k = 0; k < 6; k++) {
+    int n = k < 5 ? 0 : m.slots - m.fields;
+    for (scalar s in all)
+      if (k < 5 && !strcmp (memory_group (s.name), groups[k]))
+	n++;
+    fprintf (fp, "%s %d %.4g", groups[k], n, n*field);
+    for (scalar s in all)
+      if (k < 5 && !strcmp (memory_group (s.name), groups[k]))
+	fprintf (fp, " %s", s.name);
+    fputc ('\n', fp);
+  }
+  fprintf (fp, "# total %.4g bytes of fields, %.4g bytes with the cell headers, "
+	   "%.4g bytes resident\n", m.slots*field,
+	   (double) m.cells*(datasize + sizeof(Cell)), (double) memory_rss());
+}
+
+event memory_accounting (i++)
+{
+  static int slots = 0;
+  if (i == 0)
+    memory_report (ferr);
+  if ((int)(datasize/sizeof(double)) > slots) {
+    FILE * fp = fopen ("memory-fields", slots ? "a" : "w");
+    memory_report (fp);
+    fclose (fp);
+    slots = datasize/sizeof(double);
+  }
+  static int generation = -1;
+  if (memory_every <= 0 || i % memory_every ||
+      (i > 0 && generation == adapt_generation))
+    return 0;
+  generation = adapt_generation;
+  MemoryCount m = memory_count();
+  FILE * fp = fopen ("memory", i == 0 ? "w" : "a");
+  if (i == 0)
+    fprintf (fp, "i t leaves cells slots fields bytes rss n0 n1 ...\n");
+  fprintf (fp, "%d %g %ld %ld %d %d %.4g %ld", i, t, m.leaves, m.cells,
+	   m.slots, m.fields, (double) m.cells*(datasize + sizeof(Cell)),
+	   memory_rss());
+  for (int l = 0; l <= m.depth; l++)
+    fprintf (fp, " %ld", m.level[l]);
+  fputc ('\n', fp);
+  fclose (fp);
+}
+
+event end (t = end)
+{
+  memory_report (ferr);
+}
@@ -0,0 +1,204 @@
+/**
+# Physical milestones and early termination
+
+Every `milestone_dt` the run is checked for the milestones of a
+bursting cavity:
+
+- `collapse`: the cavity has been filled, i.e. the top of the liquid
+  column on the axis $x_a$ has risen to the level $h_\infty$ of the
+  free surface far from the axis ($y > $ `milestone_rfar`),
+- `jet`: the liquid on the axis has risen `milestone_jet` above
+  $h_\infty$,
+- `pinch`: the liquid ($f > 1/2$) has split into more than one
+  connected component, i.e. a first droplet has been ejected (the
+  components are labelled with [droplets.h](droplets.h), only once the
+  cavity has collapsed),
+- `rest`: the kinetic energy of the liquid has dropped below
+  `milestone_rest_ke` times its maximum and the yielded volume below
+  `milestone_rest_yield` times the liquid volume, for at least
+  `milestone_rest_time`.
+
+$x_a$ is the lowest position of the gas on the axis, so a bubble
+entrapped on the axis below the jet would be taken for the top of the
+column.
+
+The time of each milestone, with $x_a$, $h_\infty$, the number of
+droplets, the kinetic energy and the yielded fraction, is appended to
+`milestones` and printed on standard error. The run is stopped
+`milestone_linger` after the first milestone of the set
+`milestone_stop` (a combination of `MILESTONE_COLLAPSE`,
+`MILESTONE_JET`, `MILESTONE_PINCH` and `MILESTONE_REST`, empty by
+default: the run goes to its end). `milestone_parse()` converts a comma-separated list
+of names (e.g. from the command line) into such a set.
+
+The distance $h_\infty - x_a$ to the collapse and the number of
+droplets found by the last check are kept in `milestone_gap` and
+`milestone_ndrops` (used by [adaptive-tolerance.h](adaptive-tolerance.h)).
+
+The maximum of the kinetic energy, the start of the current rest and
+the times of the milestones depend on the whole history of the run. A
+line
+
+~~~
+t kemax trest collapse jet pinch rest
+~~~
+
+is appended to `milestones-state` whenever one of them changes. On a
+restart they are read back from the last line of the file whose time is
+not later than that of the restart (lines written after the checkpoint
+by an interrupted run are skipped). */
+
+#include "droplets.h"
+
+enum {
+  MILESTONE_COLLAPSE = 1 << 0,
+  MILESTONE_JET      = 1 << 1,
+  MILESTONE_PINCH    = 1 << 2,
+  MILESTONE_REST     = 1 << 3
+};
+
+#define MILESTONE_N 4
+
+double milestone_dt = 0.002;         // interval between two checks
+double milestone_rfar = 3.;          // free surface level taken beyond this radius
+double milestone_jet = 0.1;          // height of an emerged jet
+double milestone_rest_ke = 1e-3;     // kinetic energy at rest / maximum
+double milestone_rest_yield = 1e-3;  // yielded volume at rest / liquid volume
+double milestone_rest_time = 0.1;    // duration of the rest
+double milestone_linger = 0.05;      // time simulated after the stop milestone
+int milestone_stop = 0;              // milestones which stop the run
+
+static const char * milestone_name[MILESTONE_N] =
+  {"collapse", "jet", "pinch", "rest"};
+double milestone_time[MILESTONE_N] = {-1., -1., -1., -1.};
+double milestone_gap = HUGE;         // h_far - x_a at the last check
+int milestone_ndrops = 0;            // droplets at the last check
+
+static double milestone_kemax = 0., milestone_trest = -1.;
+
+static void milestone_state_read()
+{
+  FILE * fp = fopen ("milestones-state", "r");
+  if (!fp)
+    return;
+  double s[3 + MILESTONE_N];
+  while (fscanf (fp, "%lf %lf %lf %lf %lf %lf %lf",
+		 &s[0], &s[1], &s[2], &s[3], &s[4], &s[5], &s[6]) == 7)
+    if (s[0] <= t) {
+      milestone_kemax = s[1], milestone_trest = s[2];
+      for (int k = 0; k < MILESTONE_N; k++)
+	milestone_time[k] = s[3 + k];
+    }
+  fclose (fp);
+}
+
+static void milestone_state_write (bool first)
+{
+  static double last[2 + MILESTONE_N];
+  double s[2 + MILESTONE_N] = {milestone_kemax, milestone_trest};
+  for (int k = 0; k < MILESTONE_N; k++)
+    s[2 + k] = milestone_time[k];
+  if (!first && !memcmp (s, last, sizeof (s)))
+    return;
+  memcpy (last, s, sizeof (s));
+  FILE * fp = fopen ("milestones-state", first && t == 0. ? "w" : "a");
+  fprintf (fp, "%.17g %.17g %.17g", t, s[0], s[1]);
+  for (int k = 0; k < MILESTONE_N; k++)
+    fprintf (fp, " %.17g", s[2 + k]);
+  fputc ('\n', fp);
+  fclose (fp);
+}
+
+int milestone_parse (const char * s)
+{
+  int mask = 0;
+  for (int k = 0; k < MILESTONE_N; k++)
+    if (strstr (s, milestone_name[k]))
+      mask |= 1 << k;
+  return mask;
+}
+
+event milestones (t = 0; t += milestone_dt)
+{
+  static bool first = true;
+  if (first && t > 0.)
+    milestone_state_read();
+  evp_diagnostics();
+  double xa = HUGE, hs = 0., hw = 0., ke = 0., vl = 0., vy = 0.;
+  foreach (reduction(min:xa) reduction(+:hs) reduction(+:hw)
+	   reduction(+:ke) reduction(+:vl) reduction(+:vy)) {
+    double ff = clamp (f[], 0., 1.), level = x - Delta/2. + ff*Delta;
+    if (y < Delta && ff < 0.5 && level < xa)
+      xa = level;
+    if (y > milestone_rfar && ff > 1e-6 && ff < 1. - 1e-6)
+      hs += level*Delta, hw += Delta;
+    double dV = 2.*pi*y*sq(Delta)*ff;
+    ke += dV*(sq(u.x[]) + sq(u.y[]))/2.;
+    vl += dV;
+    if (solidreg[] > 0.)
+      vy += dV;
+  }
+  double hfar = hw > 0. ? hs/hw : 0.;
+
+  int ndrops = 0;
+  if (milestone_time[0] >= 0.) {
+    DropletList l = droplets_find (f, u, droplet_threshold);
+    ndrops = max (l.n - 1, 0);
+    free (l.d);
+  }
+  milestone_gap = hfar - xa, milestone_ndrops = ndrops;
+
+  /**
+  Rest is reached once the conditions have held for
+  `milestone_rest_time`. */
+
+  double trest = milestone_trest;
+  if (ke > milestone_kemax)
+    milestone_kemax = ke;
+  if (milestone_kemax > 0. && ke < milestone_rest_ke*milestone_kemax &&
+      vy < milestone_rest_yield*vl) {
+    if (trest < 0.)
+      trest = t;
+  }
+  else
+    trest = -1.;
+  milestone_trest = trest;
+
+  bool reached[MILESTONE_N] = {
+    xa >= hfar,
+    xa >= hfar + milestone_jet,
+    ndrops > 0,
+    trest >= 0. && t - trest >= milestone_rest_time
+  };
+
+  FILE * fp = fopen ("milestones", i == 0 ? "w" : "a");
+  if (i == 0)
+    fprintf (fp, "t milestone xa hfar ndrops ke yielded\n");
+  for (int k = 0; k < MILESTONE_N; k++)
+    if (reached[k] && milestone_time[k] < 0.) {
+      milestone_time[k] = k == 3 ? trest : t;
+      fprintf (fp, "%g %s %g %g %d %g %g\n", milestone_time[k],
+	       milestone_name[k], xa, hfar, ndrops, ke, vl > 0. ? vy/vl : 0.);
+      fprintf (ferr, "# milestone %s at t = %g\n", milestone_name[k],
+	       milestone_time[k]);
+    }
+  milestone_state_write (first);
+  first = false;
+
+  /**
+  The run stops `milestone_linger` after the first stop milestone. */
+
+  double tstop = HUGE;
+  for (int k = 0; k < MILESTONE_N; k++)
+    if ((milestone_stop & (1 << k)) && milestone_time[k] >= 0. &&
+	milestone_time[k] + milestone_linger < tstop)
+      tstop = milestone_time[k] + milestone_linger;
+  bool stop = t >= tstop;
+  if (stop) {
+    fprintf (fp, "%g stop %g %g %d %g %g\n", t, xa, hfar, ndrops, ke,
+	     vl > 0. ? vy/vl : 0.);
+    fprintf (ferr, "# milestones: stopping at t = %g\n", t);
+  }
+  fclose (fp);
+  return stop;
+}
@@ -0,0 +1,265 @@
+/**
+# NUMA placement of the threads and of the cells
+
+On a node with several sockets, the memory of the tree is first
+touched by the thread which refines the cells (`init_grid()`, the
+refinement loop of `init` and `adapt_wavelet_limited()` run serially),
+so that all the threads beyond the first socket read and write the
+fields through the inter-socket link.
+
+`foreach()` gives each thread a fixed contiguous share of the leaf
+cells (static schedule over the cache of leaves, in traversal order).
+This file
+
+1. pins each OpenMP thread to one CPU at the start of the run
+   (`numa_policy`: `spread` puts consecutive threads on the same node
+   and splits them evenly between the nodes, `compact` fills the
+   first node first, `none` leaves the threads alone). The policy can
+   be set with the environment variable `NUMA_POLICY`. The threads are
+   not pinned if `OMP_PROC_BIND` is set,
+2. after the initial refinement, and then after adaptation every
+   `numa_every` steps, moves the memory pages of the leaf cells of
+   each thread to the node of the thread (`move_pages(2)`, only the
+   pages which are on another node). The cells created by adaptation
+   thus return to the node of the thread which computes them.
+
+The data of a cell and of its siblings are contiguous in the tree, so
+that a page holds the data of a few neighbouring cells; the page of
+the first field of each leaf cell is moved. The coarser levels (used
+by the multigrid solver) are not moved.
+
+The number of nodes, the pinning, the fraction of the pages which had
+to be moved and the time spent are printed at the end of the run. On a
+machine with a single node only the pinning is done. */
+
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#ifndef MPOL_MF_MOVE
+# define MPOL_MF_MOVE (1 << 1)
+#endif
+
+#define NUMA_MAXNODES 64
+
+const char * numa_policy = "spread"; // spread, compact or none
+int numa_every = 20;                  // steps between two placements
+
+typedef struct {
+  void ** page;
+  int * status, n, nmax;
+} NumaPages;
+
+static struct {
+  int nnodes;
+  int * cpus[NUMA_MAXNODES], ncpus[NUMA_MAXNODES];
+  int nthreads, * node;               // node of each thread
+  bool pinned;
+  long pagesize;
+  NumaPages * pages;                  // per thread
+  int generation, last;
+  long nplace, checked, moved;
+  double time;
+} numa;
+
+/**
+## Topology
+
+The CPUs of each node are read from `/sys/devices/system/node`. */
+
+static int numa_cpulist (const char * s, int ** cpus)
+{
+  int n = 0, nmax = 0, a, b, len;
+  while (sscanf (s, "%d%n", &a, &len) == 1) {
+    s += len, b = a;
+    if (*s == '-' && sscanf (s + 1, "%d%n", &b, &len) == 1)
+      s += len + 1;
+    for (int c = a; c <= b; c++) {
+      if (n == nmax)
+	*cpus = realloc (*cpus, (nmax = 2*nmax + 16)*sizeof(int));
+      (*cpus)[n++] = c;
+    }
+    if (*s == ',')
+      s++;
+  }
+  return n;
+}
+
+static void numa_topology()
+{
+  numa.nnodes = 0;
+  for (int k = 0; k < NUMA_MAXNODES; k++) {
+    char name[80], line[4096];
+    sprintf (name, "/sys/devices/system/node/node%d/cpulist", k);
+    FILE * fp = fopen (name, "r");
+    if (!fp)
+      continue;
+    if (fgets (line, sizeof(line), fp)) {
+      int n = numa.nnodes;
+      numa.cpus[n] = NULL;
+      numa.ncpus[n] = numa_cpulist (line, &numa.cpus[n]);
+      if (numa.ncpus[n] > 0)
+	numa.nnodes++;
+    }
+    fclose (fp);
+  }
+  if (numa.nnodes == 0) { // no sysfs: one node with all the CPUs
+    int n = sysconf (_SC_NPROCESSORS_ONLN);
+    numa.cpus[0] = malloc (max (n, 1)*sizeof(int));
+    for (int c = 0; c < n; c++)
+      numa.cpus[0][c] = c;
+    numa.ncpus[0] = max (n, 1), numa.nnodes = 1;
+  }
+}
+
+/**
+## Pinning
+
+The CPU of thread `t` of `nt`. */
+
+static int numa_cpu (int t, int nt, bool spread)
+{
+  if (spread) {
+    int n = (long) t*numa.nnodes/nt;
+    int first = (n*nt + numa.nnodes - 1)/numa.nnodes; // first thread of node n
+    return numa.cpus[n][(t - first) % numa.ncpus[n]];
+  }
+  int total = 0;
+  for (int n = 0; n < numa.nnodes; n++)
+    total += numa.ncpus[n];
+  t %= total;
+  for (int n = 0; n < numa.nnodes; t -= numa.ncpus[n++])
+    if (t < numa.ncpus[n])
+      return numa.cpus[n][t];
+  return 0;
+}
+
+static int numa_node_of (int cpu)
+{
+  for (int n = 0; n < numa.nnodes; n++)
+    for (int c = 0; c < numa.ncpus[n]; c++)
+      if (numa.cpus[n][c] == cpu)
+	return n;
+  return 0;
+}
+
+void numa_pin()
+{
+  numa_topology();
+  numa.pagesize = sysconf (_SC_PAGESIZE);
+  const char * env = getenv ("NUMA_POLICY");
+  if (env)
+    numa_policy = env;
+  bool pin = strcmp (numa_policy, "none") && !getenv ("OMP_PROC_BIND");
+  bool spread = strcmp (numa_policy, "compact");
+  numa.pinned = pin;
+#if _OPENMP
+  numa.nthreads = omp_get_max_threads(); // npe() is 1 out of a parallel region
+#else
+  numa.nthreads = 1;
+#endif
+  numa.node = calloc (numa.nthreads, sizeof(int));
+  numa.pages = calloc (numa.nthreads, sizeof(NumaPages));
+#if _OPENMP
+  #pragma omp parallel
+  {
+    int t = pid();
+    if (pin) {
+      cpu_set_t set;
+      CPU_ZERO (&set);
+      CPU_SET (numa_cpu (t, numa.nthreads, spread), &set);
+      if (sched_setaffinity (0, sizeof(set), &set))
+	perror ("numa: sched_setaffinity");
+    }
+    numa.node[t] = numa_node_of (sched_getcpu());
+  }
+#else
+  numa.node[0] = numa_node_of (sched_getcpu());
+#endif
+}
+
+/**
+## Placement of the leaf cells
+
+The page of each leaf cell is added to the list of the thread which
+visits it, each thread asks for the node of its pages and moves those
+which are on another node. */
+
+void numa_place (scalar s)
+{
+  if (numa.nnodes < 2)
+    return;
+  timer tm = timer_start();
+  for (int t = 0; t < numa.nthreads; t++)
+    numa.pages[t].n = 0;
+  uintptr_t mask = ~(uintptr_t) (numa.pagesize - 1);
+  foreach() {
+    NumaPages * p = &numa.pages[pid()];
+    void * page = (void *) ((uintptr_t) &s[] & mask);
+    if (p->n == 0 || p->page[p->n - 1] != page) {
+      if (p->n == p->nmax) {
+	p->nmax = 2*p->nmax + 1024;
+	p->page = realloc (p->page, p->nmax*sizeof(void *));
+	p->status = realloc (p->status, p->nmax*sizeof(int));
+      }
+      p->page[p->n++] = page;
+    }
+  }
+
+  long checked = 0, moved = 0;
+#if _OPENMP
+  #pragma omp parallel reduction(+:checked) reduction(+:moved)
+#endif
+  {
+    int t = pid();
+    NumaPages * p = &numa.pages[t];
+    if (p->n > 0 &&
+	!syscall (SYS_move_pages, 0, (unsigned long) p->n, p->page, NULL,
+		  p->status, 0)) {
+      int m = 0;
+      for (int k = 0; k < p->n; k++)
+	if (p->status[k] >= 0 && p->status[k] != numa.node[t])
+	  p->page[m++] = p->page[k];
+      if (m > 0) {
+	int * nodes = malloc (m*sizeof(int));
+	for (int k = 0; k < m; k++)
+	  nodes[k] = numa.node[t];
+	syscall (SYS_move_pages, 0, (unsigned long) m, p->page, nodes,
+		 p->status, MPOL_MF_MOVE);
+	free (nodes);
+      }
+      checked += p->n, moved += m;
+    }
+  }
+  numa.nplace++, numa.checked += checked, numa.moved += moved;
+  numa.time += timer_elapsed (tm);
+}
+
+event defaults (i = 0)
+{
+  numa_pin();
+}
+
+/**
+The cells are placed at the first step, after the initial refinement,
+and then every `numa_every` steps if the tree has changed. */
+
+event numa_placement (i++)
+{
+  if (i == 0 || (i - numa.last >= numa_every &&
+		 numa.generation != adapt_generation)) {
+    numa_place (f);
+    numa.last = i, numa.generation = adapt_generation;
+  }
+}
+
+event end (t = end)
+{
+  fprintf (ferr, "# numa: %d node(s), %d threads, policy %s%s\n",
+	   numa.nnodes, numa.nthreads, numa_policy,
+	   numa.pinned ? "" : " (threads not pinned)");
+  if (numa.nplace)
+    fprintf (ferr, "# numa: %ld placements, %.3g%% of %ld pages moved, %g s\n",
+	     numa.nplace, numa.checked ? 100.*numa.moved/numa.checked : 0.,
+	     numa.checked, numa.time);
+}
@@ -0,0 +1,141 @@
+/**
+# Level-of-detail snapshots
+
+`output_lod()` writes a list of fields level by level, from the root
+to the finest level of the tree. Each level holds all its cells: the
+leaf cells and the parent cells, with the values restricted from
+their children (the averages which `adapt_wavelet_limited()` also
+computes). Reading the file up to level $L$ thus gives a consistent
+representation of the whole domain: all the cells of level $L$ and
+the leaf cells of the coarser levels. A preview at level 7 or 8 only
+reads a small prefix of the file, whatever the depth of the tree (see
+[lod-preview.c](lod-preview.c) and
+[lod.py](../04_graphical_abstract/lod.py)).
+
+~~~
+offset  type            content
+0       char[8]         magic "EVPLOD01"
+8       int32           header size H (bytes, multiple of 64)
+12      int32           number of fields nf
+16      int32           depth D
+20      int32           0
+24      double          t
+32      double[3]       X0, Y0, L0
+56      double          0
+64      char[nf][32]    field names (zero-padded)
+...     int64[D + 1][2] offset of the block of each level and its number
+                        of cells n
+...     zeros           up to H
+block   uint8[n]        1 for a leaf cell
+        int32[n]        index i of the cell in its level
+        int32[n]        index j
+        float32[nf][n]  values of the fields
+~~~
+
+Each array of a block starts on a multiple of 8 bytes. The centre of a
+cell of level $l$ is $X_0 + (i + 1/2) L_0/2^l$, $Y_0 + (j + 1/2)
+L_0/2^l$. The values are stored in single precision (as in
+[output-raster.h](output-raster.h)); the dumps remain the reference
+for restarts and exact post-processing. The cells are those of the
+local tree: with MPI, each process would write its own subdomain, so
+the snapshots are meant for serial runs. */
+
+#define LOD_MAGIC "EVPLOD01"
+#define LOD_NAMELEN 32
+#define LOD_MAXLEVEL 32
+
+static inline long lod_pad (long n)
+{
+  return (n + 7) & ~7L;
+}
+
+static inline long lod_block_bytes (long n, int nf)
+{
+  return lod_pad (n) + 2*lod_pad (4*n) + nf*lod_pad (4*n);
+}
+
+struct OutputLod {
+  scalar * list;
+  FILE * fp;
+};
+
+trace
+long output_lod (struct OutputLod p)
+{
+  if (!p.fp) p.fp = stdout;
+  int nf = list_len (p.list), maxl = min (depth(), LOD_MAXLEVEL - 1);
+  restriction (p.list);
+
+  long n[LOD_MAXLEVEL] = {0};
+  foreach_cell() {
+    if (level <= maxl)
+      n[level]++;
+    if (is_leaf (cell))
+      continue;
+  }
+
+  long header = 64 + nf*LOD_NAMELEN + 16*(maxl + 1);
+  header = 64*((header + 63)/64);
+  char * h = qcalloc (header, char);
+  memcpy (h, LOD_MAGIC, 8);
+  int ih[3] = {header, nf, maxl};
+  memcpy (h + 8, ih, sizeof(ih));
+  double dh[4] = {t, X0, Y0, L0};
+  memcpy (h + 24, dh, sizeof(dh));
+  int k = 0;
+  for (scalar s in p.list)
+    strncpy (h + 64 + LOD_NAMELEN*(k++), s.name, LOD_NAMELEN - 1);
+  int64_t * table = (int64_t *) (h + 64 + nf*LOD_NAMELEN);
+  long offset = header;
+  for (int l = 0; l <= maxl; l++) {
+    table[2*l] = offset, table[2*l + 1] = n[l];
+    offset += lod_block_bytes (n[l], nf);
+  }
+  fwrite (h, 1, header, p.fp);
+  free (h);
+
+  /**
+  The cells of each level are gathered in traversal order, in one
+  pass over the tree. */
+
+  uint8_t * leaf[maxl + 1];
+  int32_t * ci[maxl + 1], * cj[maxl + 1];
+  float * v[maxl + 1];
+  long c[maxl + 1];
+  for (int l = 0; l <= maxl; l++) {
+    leaf[l] = qcalloc (lod_pad (n[l]), uint8_t);
+    ci[l] = qmalloc (lod_pad (2*n[l]), int32_t), cj[l] = ci[l] + n[l];
+    v[l] = qmalloc (nf*n[l] + 1, float);
+    c[l] = 0;
+  }
+  foreach_cell() {
+    if (level <= maxl) {
+      long m = c[level]++;
+      leaf[level][m] = is_leaf (cell);
+      ci[level][m] = point.i - GHOSTS, cj[level][m] = point.j - GHOSTS;
+      k = 0;
+      for (scalar s in p.list) {
+	double a = s[];
+	v[level][(k++)*n[level] + m] = a == nodata ? NAN : a;
+      }
+    }
+    if (is_leaf (cell))
+      continue;
+  }
+
+  char zero[8] = {0};
+  for (int l = 0; l <= maxl; l++) {
+    fwrite (leaf[l], 1, lod_pad (n[l]), p.fp);
+    fwrite (ci[l], sizeof(int32_t), n[l], p.fp);
+    fwrite (zero, 1, lod_pad (4*n[l]) - 4*n[l], p.fp);
+    fwrite (cj[l], sizeof(int32_t), n[l], p.fp);
+    fwrite (zero, 1, lod_pad (4*n[l]) - 4*n[l], p.fp);
+    for (k = 0; k < nf; k++) {
+      fwrite (v[l] + k*n[l], sizeof(float), n[l], p.fp);
+      fwrite (zero, 1, lod_pad (4*n[l]) - 4*n[l], p.fp);
+    }
+    free (leaf[l]), free (ci[l]), free (v[l]);
+  }
+  fflush (p.fp);
+  return offset;
+}
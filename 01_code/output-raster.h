@@ -0,0 +1,160 @@
+/**
+# Binary raster output
+
+`output_raster()` samples a list of fields on a uniform $n_x\times n_y$
+grid covering `box` and writes them in a binary format which can be
+mapped without copies, e.g. with `numpy.memmap` (see
+[raster.py](../04_graphical_abstract/raster.py)):
+
+~~~
+offset  type           content
+0       char[8]        magic "EVPRAST1"
+8       int32          header size H (bytes, multiple of 64)
+12      int32          nx
+16      int32          ny
+20      int32          number of fields nf
+24      double[4]      box: x0, y0, x1, y1
+56      double         t
+64      char[nf][32]   field names (zero-padded)
+...     zeros          up to H
+H       float32[nf][ny][nx]
+~~~
+
+The value of pixel $(i,j)$ of a field is its value at
+$x_0 + (i + 1/2)(x_1 - x_0)/n_x$, $y_0 + (j + 1/2)(y_1 - y_0)/n_y$.
+Values are stored in native (little-endian on x86) byte order;
+`nodata` values, pixels outside the domain and masked pixels are
+written as NaN.
+
+The image is filled directly from the tree: each leaf cell writes the
+pixels whose centres it contains, so that no point location is needed
+and the leaf cells (i.e. the pixels) are processed in parallel by
+`foreach()`. */
+
+#define RASTER_MAGIC "EVPRAST1"
+#define RASTER_NAMELEN 32
+
+static void raster_header (FILE * fp, scalar * list, int nx, int ny,
+			   coord box[2])
+{
+  int nf = list_len (list);
+  int header = 64 + nf*RASTER_NAMELEN;
+  header = 64*((header + 63)/64);
+  char * h = qcalloc (header, char);
+  memcpy (h, RASTER_MAGIC, 8);
+  int ih[4] = {header, nx, ny, nf};
+  memcpy (h + 8, ih, sizeof(ih));
+  double dh[5] = {box[0].x, box[0].y, box[1].x, box[1].y, t};
+  memcpy (h + 24, dh, sizeof(dh));
+  int k = 0;
+  for (scalar s in list)
+    strncpy (h + 64 + RASTER_NAMELEN*(k++), s.name, RASTER_NAMELEN - 1);
+  fwrite (h, 1, header, fp);
+  free (h);
+}
+
+/**
+Bilinear interpolation within the leaf cell containing the point, with
+$(x_p, y_p)$ its position relative to the cell centre in units of
+$\Delta$ (as `interpolate_linear()`). The value of the cell is used if
+one of the neighbours is undefined. */
+
+static inline double raster_bilinear (Point point, scalar s,
+				      double xp, double yp)
+{
+  int i = sign(xp), j = sign(yp);
+  double v0 = s[], v1 = s[i], v2 = s[0,j], v3 = s[i,j];
+  if (v0 == nodata || v1 == nodata || v2 == nodata || v3 == nodata)
+    return v0;
+  xp = fabs(xp), yp = fabs(yp);
+  return (v0*(1. - xp) + v1*xp)*(1. - yp) + (v2*(1. - xp) + v3*xp)*yp;
+}
+
+/**
+Returns the number of whole pixels of size `dp` in `length`. The
+ratio is rounded when it is an integer up to rounding errors (e.g.
+1024 computed as 1023.9999999999999, which truncation would lose a
+row to), and truncated otherwise so that the pixels stay inside the
+box. */
+
+static int raster_pixels (double length, double dp)
+{
+  double r = length/dp;
+  int n = fabs (r - lround (r)) < 1e-9 ? lround (r) : (int) r;
+  return n < 1 ? 1 : n;
+}
+
+/**
+Fills the $n_x\times n_y$ image `a` with origin `o` and pixel size
+`dp`. Each pixel belongs to exactly one leaf cell (the cell boundaries
+are half-open) so the writes do not overlap. */
+
+static void raster_fill (scalar s, float * a, int nx, int ny, coord o,
+			 double dp, bool linear)
+{
+  for (long k = 0; k < (long) nx*ny; k++)
+    a[k] = NAN;
+  foreach() {
+    int i0 = max (0, (int) ceil ((x - Delta/2. - o.x)/dp - 0.5));
+    int i1 = min (nx, (int) ceil ((x + Delta/2. - o.x)/dp - 0.5));
+    int j0 = max (0, (int) ceil ((y - Delta/2. - o.y)/dp - 0.5));
+    int j1 = min (ny, (int) ceil ((y + Delta/2. - o.y)/dp - 0.5));
+    for (int jp = j0; jp < j1; jp++) {
+      double yp = (o.y + (jp + 0.5)*dp - y)/Delta;
+      for (int ip = i0; ip < i1; ip++) {
+	double xp = (o.x + (ip + 0.5)*dp - x)/Delta;
+	double v = linear ? raster_bilinear (point, s, xp, yp) : s[];
+	a[(long) jp*nx + ip] = v == nodata ? NAN : v;
+      }
+    }
+  }
+}
+
+struct OutputRaster {
+  scalar * list;
+  FILE * fp;
+  int n;          // number of pixels along x (default 1024)
+  bool linear;    // bilinear interpolation
+  coord box[2];   // default: the whole domain
+  scalar * mask;  // optional {c}: pixels where c < 1/2 are set to NaN
+};
+
+trace
+void output_raster (struct OutputRaster p)
+{
+  if (!p.fp) p.fp = stdout;
+  if (p.n == 0) p.n = 1024;
+  if (p.box[0].x == 0. && p.box[0].y == 0. &&
+      p.box[1].x == 0. && p.box[1].y == 0.) {
+    p.box[0].x = X0, p.box[0].y = Y0;
+    p.box[1].x = X0 + L0, p.box[1].y = Y0 + L0;
+  }
+  coord * box = p.box;
+  double dp = (box[1].x - box[0].x)/p.n;
+  int nx = p.n, ny = raster_pixels (box[1].y - box[0].y, dp);
+  long np = (long) nx*ny;
+
+  /**
+  Pixels are square: the box stored in the header is the one actually
+  covered by the $n_x\times n_y$ pixels. */
+
+  coord cover[2] = {box[0], {box[0].x + nx*dp, box[0].y + ny*dp}};
+  raster_header (p.fp, p.list, nx, ny, cover);
+
+  float * a = qmalloc (np, float), * mask = NULL;
+  if (p.mask) {
+    mask = qmalloc (np, float);
+    raster_fill (p.mask[0], mask, nx, ny, box[0], dp, p.linear);
+  }
+  for (scalar s in p.list) {
+    raster_fill (s, a, nx, ny, box[0], dp, p.linear);
+    if (mask)
+      for (long k = 0; k < np; k++)
+	if (!(mask[k] >= 0.5))
+	  a[k] = NAN;
+    fwrite (a, sizeof(float), np, p.fp);
+  }
+  free (a);
+  free (mask);
+  fflush (p.fp);
+}
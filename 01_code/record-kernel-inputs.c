@@ -0,0 +1,113 @@
+/**
+# Recording of the inputs of the log-conformation kernels
+
+Restores a snapshot written by [burst_evp.c](burst_evp.c) and writes,
+for its liquid cells ($\lambda > 0$), the inputs of
+`upper_convective()` and `model_term()` of
+[log-conform-kernels.h](log-conform-kernels.h): material properties,
+reference stress, velocity differences, cell size and time step, as
+`KernelInput` records. [kernel-bench.c](kernel-bench.c) replays them
+outside of the grid, so that changes of the kernels are measured and
+checked on the conformation tensors of an actual run.
+
+~~~bash
+qcc -O2 -Wall -disable-dimensions record-kernel-inputs.c -o record-kernel-inputs -lm
+./record-kernel-inputs [-a] [-n max] [-d dt] snapshot cells.kin
+~~~
+
+`-a` records all the leaf cells, `-n` at most `max` cells (evenly
+spaced in traversal order) and `-d` sets the time step stored with the
+records (by default `DT_MAX` of burst_evp.c). */
+
+#include <getopt.h>
+
+#include "axi.h"
+#include "navier-stokes/centered.h"
+#include "two-phase.h"
+#include "navier-stokes/conserving.h"
+#include "tension-cached.h"
+#include "log-conform-EVP.h"
+#include "saramito-EVP.h"
+
+#define Ldomain 8
+
+scalar mupv[], lambdav[], tau0v[];
+
+u.n[right] = neumann(0.);
+p[right] = dirichlet(0.);
+
+int main (int argc, char * argv[])
+{
+  bool all = false;
+  long nmax = 0;
+  double dtrec = 5e-4;
+  int opt;
+  while ((opt = getopt (argc, argv, "an:d:")) != -1)
+    switch (opt) {
+    case 'a': all = true; break;
+    case 'n': nmax = atol (optarg); break;
+    case 'd': dtrec = atof (optarg); break;
+    default:
+      fprintf (ferr, "usage: %s [-a] [-n max] [-d dt] snapshot output\n", argv[0]);
+      return 1;
+    }
+  if (argc - optind != 2) {
+    fprintf (ferr, "usage: %s [-a] [-n max] [-d dt] snapshot output\n", argv[0]);
+    return 1;
+  }
+
+  L0 = Ldomain;
+  origin (-L0/2., 0.);
+  init_grid (1 << 6);
+
+  // allocated in the defaults event of log-conform-EVP.h when running
+  trA = new scalar;
+  solidreg = new scalar;
+
+  lambda = lambdav;
+  mup = mupv;
+  tau0 = tau0v;
+
+  if (!restore (file = argv[optind])) {
+    fprintf (ferr, "record-kernel-inputs: could not restore %s\n", argv[optind]);
+    return 1;
+  }
+
+  long n = 0;
+  foreach (reduction(+:n))
+    if (all || lambda[] > 0.)
+      n++;
+  long stride = nmax > 0 && n > nmax ? (n + nmax - 1)/nmax : 1;
+
+  KernelInput * r = malloc (sizeof(KernelInput)*(n/stride + 1));
+  long k = 0, nr = 0;
+  foreach (serial)
+    if (all || lambda[] > 0.) {
+      if (k++ % stride == 0) {
+	pseudo_t T, du;
+	double Tqq, uqq;
+	ref_stress_get (point, &T, &Tqq);
+	velocity_differences (point, &du, &uqq);
+	r[nr++] = (KernelInput){
+	  lambda[], mup[], tau0[], trA[],
+	  T.x.x, T.x.y, T.y.y, Tqq, tau_qq[],
+	  du.x.x, du.x.y, du.y.x, du.y.y, uqq,
+	  Delta, dtrec
+	};
+      }
+    }
+
+  FILE * fp = fopen (argv[optind + 1], "w");
+  if (!fp) {
+    perror (argv[optind + 1]);
+    return 1;
+  }
+  int32_t nw = nr;
+  fwrite (KERNEL_INPUT_MAGIC, 1, 8, fp);
+  fwrite (&nw, sizeof(int32_t), 1, fp);
+  fwrite (r, sizeof(KernelInput), nr, fp);
+  fclose (fp);
+  fprintf (ferr, "%s: %ld records of %ld cells\n", argv[optind + 1], nr, n);
+  free (r);
+  return 0;
+}
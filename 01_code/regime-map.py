@@ -0,0 +1,297 @@
+"""
+Adaptive sampling of the (J, De) regime map with burst_evp.c:
+
+    python3 regime-map.py [options]
+    python3 regime-map.py --J 0.1 --De 0.01 100      # De sweep at J = 0.1
+
+Starts from a coarse grid of cases, uniform in log10 J and log10 De
+(cells --coarse decades wide), classifies each finished case from its
+diagnostics and only adds cases in the cells of the map whose cases
+are in different regimes, as the adaptive trees of Basilisk do: a
+cell is split into four when the
+regimes differ at its corners (or at the cases already run on its
+edges), until the cells are --resolution decades wide. A parameter
+given with a single value is kept fixed and the map is sampled along
+the other one only.
+
+A regime is given by
+- whether the cavity collapses and a jet emerges (milestones),
+- the number of droplets, up to --drops-max (the largest number of
+  components of the liquid in `droplets`, minus the bulk),
+- whether the largest yielded fraction of the liquid (vy/vl in
+  `budget`) reaches --yield-split.
+
+The cases run in parallel, --threads OpenMP threads each, as many as
+the local cores allow (--jobs), and stop at the --stop milestone (see
+milestones.h). Each case is run in <dir>/J<J>-De<De>/, where a case
+already done is read back instead of being run again, so an
+interrupted or refined sweep (smaller --resolution) goes on from where
+it stopped. The map is written to <dir>/regime-map after each case:
+
+    J De regime collapse jet drops yielded tend time level
+
+with the end time of the run, its wall-clock time and the level of the
+map at which the case was added. At the end, the number of cases run is
+compared with that of the uniform grid of the same resolution.
+"""
+import argparse
+import concurrent.futures as cf
+import math
+import os
+import shutil
+import subprocess
+import sys
+import time
+
+
+def load_table(path):
+    if not os.path.exists(path):
+        return [], []
+    with open(path) as fp:
+        header = fp.readline().split()
+        rows = [line.split() for line in fp if line.strip()]
+    return header, rows
+
+
+def classify(directory, drops_max, yield_split):
+    """Regime of a finished case, from its milestones, droplets and
+    budget, or None when the case wrote nothing."""
+    _, rows = load_table(os.path.join(directory, 'milestones'))
+    reached = {r[1] for r in rows}
+    header, rows = load_table(os.path.join(directory, 'budget'))
+    if not rows:
+        return None
+    k, vl, vy = header.index('t'), header.index('vl'), header.index('vy')
+    tend = float(rows[-1][k])
+    yielded = max((float(r[vy])/float(r[vl]) for r in rows if float(r[vl]) > 0.),
+                  default=0.)
+    count = {}
+    for r in load_table(os.path.join(directory, 'droplets'))[1]:
+        count[r[0]] = count.get(r[0], 0) + 1
+    drops = min(max(count.values(), default=1) - 1, drops_max)
+    case = {
+        'collapse': int('collapse' in reached),
+        'jet': int('jet' in reached),
+        'drops': drops,
+        'yielded': yielded,
+        'tend': tend,
+    }
+    name = 'jet' if case['jet'] else 'collapse' if case['collapse'] else 'cavity'
+    if drops > 0:
+        name += f"-{drops}{'+' if drops == drops_max else ''}drops"
+    name += '-yielded' if yielded >= yield_split else '-plug'
+    case['regime'] = name
+    return case
+
+
+class Axis:
+    """One parameter, uniform in log10, with cells of the coarsest grid
+    at most `coarse` decades wide."""
+
+    def __init__(self, name, values, coarse):
+        self.name = name
+        self.lo, self.hi = math.log10(values[0]), math.log10(values[-1])
+        self.fixed = len(values) == 1 or self.hi == self.lo
+        self.cells = 0 if self.fixed else math.ceil((self.hi - self.lo)/coarse - 1e-9)
+        self.width = 0. if self.fixed else (self.hi - self.lo)/self.cells
+
+    def value(self, a, size):
+        if self.fixed:
+            return 10.**self.lo
+        return 10.**(self.lo + (self.hi - self.lo)*a/size)
+
+
+class Sampler:
+    """Cells of the map (lower corner and width on the finest lattice)
+    and the cases at their corners."""
+
+    def __init__(self, axes, resolution):
+        self.axes = axes
+        width = max(a.width for a in axes)
+        self.levels = max(0, math.ceil(math.log2(width/resolution) - 1e-9)) \
+            if width > 0. else 0
+        self.width = 1 << self.levels
+        self.size = [a.cells*self.width for a in axes]
+        self.cases = {}          # lattice point -> case (None while running)
+        self.level = {}          # lattice point -> level at which it was added
+        self.cells = [((i*self.width if not axes[0].fixed else 0,
+                        j*self.width if not axes[1].fixed else 0), 0)
+                      for i in range(max(1, axes[0].cells))
+                      for j in range(max(1, axes[1].cells))]
+        for cell in self.cells:
+            for p in self.corners(cell):
+                self.level.setdefault(p, 0)
+
+    def steps(self, w):
+        return [[0] if a.fixed else [0, w] for a in self.axes]
+
+    def corners(self, cell):
+        (a, b), level = cell
+        w = self.width >> level
+        sa, sb = self.steps(w)
+        return [(a + i, b + j) for i in sa for j in sb]
+
+    def edges(self, cell):
+        """Points of the next level on the boundary of the cell."""
+        (a, b), level = cell
+        w = self.width >> level
+        if w < 2:
+            return []
+        pa, pb = [[0] if x.fixed else [0, w//2, w] for x in self.axes]
+        return [(a + i, b + j) for i in pa for j in pb
+                if any(not x.fixed and d in (0, w)
+                       for x, d in zip(self.axes, (i, j)))]
+
+    def parameters(self, p):
+        return [x.value(p[k], self.size[k]) for k, x in enumerate(self.axes)]
+
+    def refine(self):
+        """Splits the cells whose corners are done and in different
+        regimes. Returns the new points."""
+        new, cells = [], []
+        for cell in self.cells:
+            (a, b), level = cell
+            corners = [self.cases.get(p) for p in self.corners(cell)]
+            if level >= self.levels or any(c is None for c in corners):
+                cells.append(cell)
+                continue
+            known = corners + [self.cases[p] for p in self.edges(cell)
+                               if self.cases.get(p)]
+            regimes = {c['regime'] for c in known}
+            if len(regimes) == 1 or 'failed' in regimes:
+                cells.append(cell)
+                continue
+            w = (self.width >> level)//2
+            sa, sb = self.steps(w)
+            for i in sa:
+                for j in sb:
+                    child = ((a + i, b + j), level + 1)
+                    cells.append(child)
+                    for p in self.corners(child):
+                        if p not in self.level:
+                            self.level[p] = level + 1
+                            new.append(p)
+        self.cells = cells
+        return new
+
+
+def case_directory(root, J, De):
+    return os.path.join(root, f"J{J:.4g}-De{De:.4g}")
+
+
+def run_case(args, J, De):
+    """Runs one case, unless it is already done. Returns its regime."""
+    directory = case_directory(args.dir, J, De)
+    done = os.path.join(directory, 'done')
+    if not os.path.exists(done):
+        os.makedirs(directory, exist_ok=True)
+        shutil.copy('Bo0.0010.dat', directory)
+        env = dict(os.environ, OMP_NUM_THREADS=str(args.threads))
+        start = time.time()
+        with open(os.path.join(directory, 'out'), 'w') as out, \
+             open(os.path.join(directory, 'err'), 'w') as err:
+            status = subprocess.call([os.path.abspath(args.exe), f"{J:.4g}",
+                                      f"{De:.4g}", args.stop],
+                                     cwd=directory, stdout=out, stderr=err,
+                                     env=env)
+        with open(done, 'w') as fp:
+            fp.write(f"{status} {time.time() - start:g}\n")
+    with open(done) as fp:
+        status, elapsed = fp.read().split()
+    case = classify(directory, args.drops_max, args.yield_split)
+    if case is None or int(status) != 0:
+        case = dict(case or {'collapse': 0, 'jet': 0, 'drops': 0,
+                             'yielded': 0., 'tend': 0.}, regime='failed')
+        print(f"{directory}: failed (status {status}), see {directory}/err",
+              file=sys.stderr)
+    case['time'] = float(elapsed)
+    return case
+
+
+def write_map(path, sampler):
+    with open(path, 'w') as fp:
+        fp.write("J De regime collapse jet drops yielded tend time level\n")
+        for p in sorted(sampler.cases):
+            c = sampler.cases[p]
+            if c is None:
+                continue
+            J, De = sampler.parameters(p)
+            fp.write(f"{J:.4g} {De:.4g} {c['regime']} {c['collapse']} "
+                     f"{c['jet']} {c['drops']} {c['yielded']:.4g} "
+                     f"{c['tend']:g} {c['time']:.4g} {sampler.level[p]}\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Adaptive (J, De) regime map with burst_evp')
+    parser.add_argument('--J', type=float, nargs='+', default=[0.01, 1.],
+                        help='range of J (one value: fixed)')
+    parser.add_argument('--De', type=float, nargs='+', default=[0.01, 100.],
+                        help='range of De (one value: fixed)')
+    parser.add_argument('--coarse', type=float, default=0.5,
+                        help='width of the cells of the coarsest grid (decades)')
+    parser.add_argument('--resolution', type=float, default=0.125,
+                        help='width of the finest cells (decades)')
+    parser.add_argument('--drops-max', type=int, default=1,
+                        help='droplet counts above this are one regime')
+    parser.add_argument('--yield-split', type=float, default=0.5,
+                        help='yielded fraction separating yielded and plug flows')
+    parser.add_argument('--stop', default='rest',
+                        help='milestones which end each run')
+    parser.add_argument('--threads', type=int, default=1,
+                        help='OpenMP threads per case')
+    parser.add_argument('--jobs', type=int, default=0,
+                        help='cases run at once (default: cores/threads)')
+    parser.add_argument('--exe', default='burst_evp_sweep')
+    parser.add_argument('--dir', default='sweep')
+    args = parser.parse_args()
+
+    if not os.path.exists(args.exe):
+        build = ['qcc', '-O2', '-Wall', '-disable-dimensions', '-fopenmp',
+                 '-DENERGY_BUDGET=1', '-DMILESTONES=1', '-DDROPLETS=1',
+                 'burst_evp.c', '-o', args.exe, '-lm']
+        print(' '.join(build), file=sys.stderr)
+        subprocess.check_call(build)
+    jobs = args.jobs or max(1, (os.cpu_count() or 1)//args.threads)
+    os.makedirs(args.dir, exist_ok=True)
+
+    axes = [Axis('J', sorted(args.J), args.coarse),
+            Axis('De', sorted(args.De), args.coarse)]
+    sampler = Sampler(axes, args.resolution)
+    queue = sorted(sampler.level)
+    running = {}
+    start = time.time()
+    with cf.ThreadPoolExecutor(max_workers=jobs) as pool:
+        while queue or running:
+            while queue and len(running) < jobs:
+                p = queue.pop(0)
+                sampler.cases[p] = None
+                running[pool.submit(run_case, args, *sampler.parameters(p))] = p
+            finished, _ = cf.wait(running, return_when=cf.FIRST_COMPLETED)
+            for future in finished:
+                p = running.pop(future)
+                case = future.result()
+                sampler.cases[p] = case
+                J, De = sampler.parameters(p)
+                print(f"J = {J:.4g}, De = {De:.4g}: {case['regime']} "
+                      f"(t = {case['tend']:g}, {case['time']:.4g} s), "
+                      f"{len(running)} running, {len(queue)} queued",
+                      file=sys.stderr)
+            write_map(os.path.join(args.dir, 'regime-map'), sampler)
+            queue += sampler.refine()
+
+    cases = [c for c in sampler.cases.values() if c]
+    uniform = 1
+    for k, a in enumerate(axes):
+        uniform *= sampler.size[k] + 1
+    print(f"{len(cases)} cases ({sum(c['regime'] == 'failed' for c in cases)} "
+          f"failed), {len({c['regime'] for c in cases})} regimes, "
+          f"{sum(c['time'] for c in cases):.4g} s of runs in "
+          f"{time.time() - start:.4g} s with {jobs} jobs")
+    print(f"uniform grid of the same resolution: {uniform} cases, "
+          f"{100.*(1. - len(cases)/uniform):.1f}% saved")
+    print(f"map written to {os.path.join(args.dir, 'regime-map')}")
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,269 @@
+/**
+# In-situ movie frames
+
+Every `frame_dt` a frame is rendered directly from the tree and handed
+to a background thread. The thread writes it as a binary PPM either to
+a pipe (`frame_pipe`, e.g. an `ffmpeg` command) or to the numbered
+files `frames/frame-<k>.ppm`. No snapshot has to be dumped and
+restored to make the movies.
+
+The image shows the axisymmetric cavity with the axis vertical (the
+axial direction $x$ upwards) and the radial direction mirrored, with
+one field on each side:
+
+- left: $\log_{10}\sqrt{\mathcal{D}:\mathcal{D}}$ with the `hot`
+  colour map,
+- right: the flow-topology parameter $\mathcal{Q}$ (second
+  definition, see [velocity-gradient.h](velocity-gradient.h)) in the
+  liquid, with the `RdBu` colour map,
+- the interface ($f = 1/2$) in black and the yield surface (sign change
+  of `solidreg` within the liquid) in cyan.
+
+The panels are `frame_left` and `frame_right`. They can be pointed to
+other fields, colour maps and ranges before `run()`. All the fields are
+sampled with `raster_fill()` of [output-raster.h](output-raster.h), in
+parallel over the leaf cells.
+
+Compile with `-pthread`. */
+
+#include <pthread.h>
+#include "output-raster.h"
+#include "velocity-gradient.h"
+#include "colormaps.h"
+
+double frame_dt = 0.01;            // interval between two frames
+int frame_height = 1024;           // pixels along the axis
+coord frame_box[2] = {{-4., 0.}, {4., 4.}}; // axial and radial extent
+char * frame_pipe = NULL;          // command the frames are piped to
+
+typedef struct {
+  scalar s;
+  Colormap map;
+  double min, max;
+  bool liquid;                     // only shown where f > 1/2
+} FramePanel;
+
+scalar frame_D2[], frame_Q[];
+FramePanel frame_left, frame_right;
+
+/**
+## Background writer
+
+Rendered frames are queued in a ring of `FRAME_QUEUE` buffers. The
+simulation only waits if the writer is more than `FRAME_QUEUE` frames
+behind. */
+
+#define FRAME_QUEUE 4
+
+static struct {
+  int W, H;
+  unsigned char * buf[FRAME_QUEUE];
+  int index[FRAME_QUEUE];
+  int head, count;
+  bool started, stop;
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  FILE * pipe;
+  int nframes;
+  double render, wait;             // accumulated times (s)
+} frame_writer = {
+  .lock = PTHREAD_MUTEX_INITIALIZER,
+  .cond = PTHREAD_COND_INITIALIZER
+};
+
+static void frame_write (const unsigned char * rgb, int k)
+{
+  FILE * fp = frame_writer.pipe;
+  if (!fp) {
+    char name[80];
+    sprintf (name, "frames/frame-%05d.ppm", k);
+    if (!(fp = fopen (name, "w"))) {
+      perror (name);
+      return;
+    }
+  }
+  fprintf (fp, "P6\n%d %d\n255\n", frame_writer.W, frame_writer.H);
+  fwrite (rgb, 3, (size_t) frame_writer.W*frame_writer.H, fp);
+  if (fp == frame_writer.pipe)
+    fflush (fp);
+  else
+    fclose (fp);
+}
+
+static void * frame_writer_loop (void * arg)
+{
+  pthread_mutex_lock (&frame_writer.lock);
+  for (;;) {
+    while (!frame_writer.count && !frame_writer.stop)
+      pthread_cond_wait (&frame_writer.cond, &frame_writer.lock);
+    if (!frame_writer.count)
+      break;
+    int h = frame_writer.head;
+    pthread_mutex_unlock (&frame_writer.lock);
+    frame_write (frame_writer.buf[h], frame_writer.index[h]);
+    pthread_mutex_lock (&frame_writer.lock);
+    frame_writer.head = (h + 1) % FRAME_QUEUE;
+    frame_writer.count--;
+    pthread_cond_broadcast (&frame_writer.cond);
+  }
+  pthread_mutex_unlock (&frame_writer.lock);
+  return NULL;
+}
+
+static void frame_writer_start (int W, int H)
+{
+  frame_writer.W = W, frame_writer.H = H;
+  for (int k = 0; k < FRAME_QUEUE; k++)
+    frame_writer.buf[k] = qmalloc (3*W*H, unsigned char);
+  if (frame_pipe) {
+    if (!(frame_writer.pipe = popen (frame_pipe, "w"))) {
+      perror (frame_pipe);
+      exit (1);
+    }
+  }
+  else
+    system ("mkdir -p frames");
+  pthread_create (&frame_writer.thread, NULL, frame_writer_loop, NULL);
+  frame_writer.started = true;
+}
+
+/**
+Returns a free buffer, waiting for the writer if all are queued. */
+
+static int frame_writer_acquire()
+{
+  timer tm = timer_start();
+  pthread_mutex_lock (&frame_writer.lock);
+  while (frame_writer.count == FRAME_QUEUE)
+    pthread_cond_wait (&frame_writer.cond, &frame_writer.lock);
+  int slot = (frame_writer.head + frame_writer.count) % FRAME_QUEUE;
+  pthread_mutex_unlock (&frame_writer.lock);
+  frame_writer.wait += timer_elapsed (tm);
+  return slot;
+}
+
+static void frame_writer_push (int slot, int k)
+{
+  pthread_mutex_lock (&frame_writer.lock);
+  frame_writer.index[slot] = k;
+  frame_writer.count++;
+  pthread_cond_broadcast (&frame_writer.cond);
+  pthread_mutex_unlock (&frame_writer.lock);
+}
+
+static void frame_writer_stop()
+{
+  if (!frame_writer.started)
+    return;
+  pthread_mutex_lock (&frame_writer.lock);
+  frame_writer.stop = true;
+  pthread_cond_broadcast (&frame_writer.cond);
+  pthread_mutex_unlock (&frame_writer.lock);
+  pthread_join (frame_writer.thread, NULL);
+  if (frame_writer.pipe)
+    pclose (frame_writer.pipe);
+  for (int k = 0; k < FRAME_QUEUE; k++)
+    free (frame_writer.buf[k]);
+  frame_writer.started = false;
+}
+
+/**
+## Rendering */
+
+event defaults (i = 0)
+{
+  frame_D2.nodump = frame_Q.nodump = true;
+  if (!frame_left.map)
+    frame_left = (FramePanel){frame_D2, hot, -1., 2., false};
+  if (!frame_right.map)
+    frame_right = (FramePanel){frame_Q, rdbu, -1., 1., true};
+}
+
+static inline bool frame_edge (const float * a, int nx, int ny, int ip,
+			       int jp, double level)
+{
+  bool in = a[jp*nx + ip] > level;
+  return (ip > 0 && (a[jp*nx + ip - 1] > level) != in) ||
+    (ip < nx - 1 && (a[jp*nx + ip + 1] > level) != in) ||
+    (jp > 0 && (a[(jp - 1)*nx + ip] > level) != in) ||
+    (jp < ny - 1 && (a[(jp + 1)*nx + ip] > level) != in);
+}
+
+event render_frames (t = 0; t += frame_dt)
+{
+  evp_diagnostics();
+  timer tm = timer_start();
+  double dp = (frame_box[1].x - frame_box[0].x)/frame_height;
+  int nx = frame_height, ny = raster_pixels (frame_box[1].y - frame_box[0].y, dp);
+  int W = 2*ny, H = nx;
+  if (!frame_writer.started)
+    frame_writer_start (W, H);
+
+  foreach() {
+    vgrad gu = velocity_gradient (point, u, 1./(2.*Delta));
+    double DD = vgrad_DD (gu), SS = vgrad_SS (gu);
+    frame_D2[] = DD > 0. ? log10 (sqrt (DD)) : -10.;
+    frame_Q[] = topology_Q2 (sqrt (DD/2.), sqrt (SS/2.));
+  }
+
+  /**
+  The samples are stored with the axial index $i_p$ running fastest,
+  as in [output-raster.h](output-raster.h). */
+
+  static float * a[4];
+  static long na = 0;
+  long np = (long) nx*ny;
+  if (np > na) {
+    for (int k = 0; k < 4; k++)
+      a[k] = qrealloc (a[k], np, float);
+    na = np;
+  }
+  raster_fill (frame_left.s, a[0], nx, ny, frame_box[0], dp, true);
+  raster_fill (frame_right.s, a[1], nx, ny, frame_box[0], dp, true);
+  raster_fill (f, a[2], nx, ny, frame_box[0], dp, true);
+  raster_fill (solidreg, a[3], nx, ny, frame_box[0], dp, false);
+
+  double cl[NCMAP][3], cr[NCMAP][3];
+  frame_left.map (cl);
+  frame_right.map (cr);
+
+  frame_writer.render += timer_elapsed (tm);
+  int slot = frame_writer_acquire();
+  tm = timer_start();
+  unsigned char * rgb = frame_writer.buf[slot];
+  float * fl = a[2], * yr = a[3];
+
+  #pragma omp parallel for schedule(static)
+  for (int r = 0; r < H; r++) {
+    int ip = H - 1 - r;
+    for (int c = 0; c < W; c++) {
+      bool left = c < ny;
+      int jp = left ? ny - 1 - c : c - ny;
+      long k = (long) jp*nx + ip;
+      FramePanel * p = left ? &frame_left : &frame_right;
+      float v = a[left ? 0 : 1][k];
+      unsigned char * px = rgb + 3*((long) r*W + c);
+      color col = {255, 255, 255};
+      if (isnan (fl[k]) || isnan (v) || (p->liquid && !(fl[k] > 0.5)))
+	;
+      else
+	col = colormap_color (left ? cl : cr, v, p->min, p->max);
+      if (!isnan (fl[k]) && frame_edge (fl, nx, ny, ip, jp, 0.5))
+	col = (color){0, 0, 0};
+      else if (fl[k] > 0.5 && frame_edge (yr, nx, ny, ip, jp, 0.))
+	col = (color){0, 200, 255};
+      px[0] = col.r, px[1] = col.g, px[2] = col.b;
+    }
+  }
+
+  frame_writer_push (slot, frame_writer.nframes++);
+  frame_writer.render += timer_elapsed (tm);
+}
+
+event end (t = end)
+{
+  frame_writer_stop();
+  fprintf (ferr, "# frames: %d, render %g s, waiting for the writer %g s\n",
+	   frame_writer.nframes, frame_writer.render, frame_writer.wait);
+}
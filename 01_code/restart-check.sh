@@ -0,0 +1,52 @@
+#!/bin/bash
+# Checks that a run restarted from the checkpoints of checkpoint.h (a
+# full dump and its deltas) follows the run which was never
+# interrupted.
+#
+# Usage (from 01_code):
+#   ./restart-check.sh [J] [De] [tstop] [tend] [tol]
+#
+# Both runs use -DCHECKPOINT_FULL=4 (a full dump every 4 checkpoints,
+# deltas in between), on one thread so that the reductions are
+# reproducible. In check/J<J>-De<De>/whole the case runs to tend; in
+# check/J<J>-De<De>/restart it first stops at tstop, where the restart
+# file is a full dump and deltas, and is then restarted up to tend. The
+# snapshots at tend are compared with compare-snapshots.c and the check
+# fails if the largest difference of a field is more than tol times its
+# largest value (default 1e-3: besides the tolerance of the deltas, the
+# first step after the restart is computed without the previous time
+# step).
+set -e
+
+J=${1:-0.1}
+De=${2:-0.04}
+tstop=${3:-0.03}
+tend=${4:-0.05}
+tol=${5:-1e-3}
+
+qcc -O2 -Wall -disable-dimensions -DCHECKPOINT_FULL=4 -Dtmax=$tstop \
+    burst_evp.c -o burst_evp_stop -lm
+qcc -O2 -Wall -disable-dimensions -DCHECKPOINT_FULL=4 -Dtmax=$tend \
+    burst_evp.c -o burst_evp_end -lm
+gcc -O2 -Wall compare-snapshots.c -o compare-snapshots -pthread -lm
+
+dir=check/J$J-De$De
+rm -rf $dir
+mkdir -p $dir/whole $dir/restart
+export OMP_NUM_THREADS=1
+cp Bo0.0010.dat burst_evp_end $dir/whole/
+cp Bo0.0010.dat burst_evp_stop burst_evp_end $dir/restart/
+(cd $dir/whole && ./burst_evp_end $J $De > out 2> err)
+(cd $dir/restart && ./burst_evp_stop $J $De > out-stop 2> err-stop &&
+     ls dump-delta-* > /dev/null &&
+     ./burst_evp_end $J $De > out 2> err)
+grep '# checkpoint:' $dir/restart/err
+
+snap=intermediate/snapshot-$(printf '%5.4f' $tend)
+./compare-snapshots $dir/whole/$snap $dir/restart/$snap | tee $dir/compare
+awk -v tol=$tol '
+  /^field/ { fields = 1; next }
+  /^surface/ { fields = 0 }
+  fields && $4 > tol*$7 { print "restart-check: " $1 " differs by " $4 " (max " $7 ")"; bad = 1 }
+  END { exit bad }' $dir/compare
+echo "restart-check: restarted run within $tol of the uninterrupted one"
@@ -0,0 +1,204 @@
+/**
+# Surface-of-revolution meshes
+
+Binary PLY meshes for 3D renders (e.g. with
+[blender_import_ply.py](../04_graphical_abstract/blender_import_ply.py)),
+written straight from the tree:
+
+- `revolve_ply()`: the surface obtained by revolving polylines of the
+  meridional plane around the axis, e.g. the interface and the yield
+  surface given by [contours.h](contours.h),
+- `meridional_plane_ply()`: a plane coloured by a field, with one vertex
+  per sample of the raster of [output-raster.h](output-raster.h).
+
+The meshes use the coordinates of `blender_script.py`: the axial
+direction $x$ of the simulation is $Z$ and a point at distance $r = y$
+from the axis at angle $\theta$ is at $X = r\cos\theta$, $Y =
+r\sin\theta$. */
+
+#include "contours.h"
+#include "output-raster.h"
+#include "colormaps.h"
+
+/**
+## Writers
+
+Both writers build the vertex and face arrays in memory and write them
+with a single `fwrite()` each. */
+
+static void ply_header (FILE * fp, long nv, long nf, bool colors)
+{
+  fprintf (fp,
+	   "ply\n"
+	   "format binary_little_endian 1.0\n"
+	   "element vertex %ld\n"
+	   "property float x\n"
+	   "property float y\n"
+	   "property float z\n", nv);
+  if (colors)
+    fprintf (fp,
+	     "property uchar red\n"
+	     "property uchar green\n"
+	     "property uchar blue\n"
+	     "property uchar alpha\n");
+  fprintf (fp,
+	   "element face %ld\n"
+	   "property list uchar int vertex_indices\n"
+	   "end_header\n", nf);
+}
+
+#pragma pack(push, 1)
+typedef struct { unsigned char n; int v[3]; } PlyTriangle;
+typedef struct { unsigned char n; int v[4]; } PlyQuad;
+typedef struct { float x, y, z; unsigned char r, g, b, a; } PlyColorVertex;
+#pragma pack(pop)
+
+/**
+Each polyline is revolved by `angle` (default $\pi$, as in
+`blender_script.py`) in `steps` steps. Consecutive points of a
+polyline share their vertices, so the surface is watertight along the
+polylines. */
+
+struct RevolvePly {
+  FILE * fp;
+  Polylines * l;
+  int steps;      // default 64
+  double angle;   // default pi
+};
+
+void revolve_ply (struct RevolvePly p)
+{
+  if (!p.steps) p.steps = 64;
+  if (!p.angle) p.angle = pi;
+  int m = p.steps, np = p.l->np;
+  float (* v)[3] = malloc (sizeof(float[3])*(long) np*m);
+  for (int k = 0; k < m; k++) {
+    double theta = p.angle*k/(m - 1.), c = cos(theta), s = sin(theta);
+    for (int i = 0; i < np; i++) {
+      coord q = p.l->p[i];
+      v[(long) k*np + i][0] = q.y*c;
+      v[(long) k*np + i][1] = q.y*s;
+      v[(long) k*np + i][2] = q.x;
+    }
+  }
+  PlyTriangle * t = malloc (sizeof(PlyTriangle)*2L*np*(m - 1));
+  long nt = 0;
+  for (int j = 0; j < p.l->n; j++) {
+    int i0 = p.l->start[j], i1 = p.l->start[j + 1];
+    int last = p.l->closed[j] ? i1 : i1 - 1;
+    for (int i = i0; i < last; i++) {
+      int i2 = i + 1 < i1 ? i + 1 : i0;
+      for (int k = 0; k < m - 1; k++) {
+	int a = k*np + i, b = k*np + i2, c = a + np, d = b + np;
+	t[nt++] = (PlyTriangle){3, {a, b, d}};
+	t[nt++] = (PlyTriangle){3, {a, d, c}};
+      }
+    }
+  }
+  ply_header (p.fp, (long) np*m, nt, false);
+  fwrite (v, sizeof(float[3]), (long) np*m, p.fp);
+  fwrite (t, sizeof(PlyTriangle), nt, p.fp);
+  free (v), free (t);
+}
+
+/**
+The plane $Y = 0$ on the side `side` ($+1$: $X = r$, $-1$: $X = -r$)
+of the axis, coloured with `map` between `min` and `max`. Samples
+outside the domain are dropped; those where `mask` is below 1/2 are
+transparent, and quads with four transparent corners are dropped. */
+
+struct MeridionalPly {
+  FILE * fp;
+  scalar s;
+  Colormap map;
+  double min, max;
+  int n;          // number of samples along the axis (default 512)
+  coord box[2];   // default: the whole domain
+  scalar * mask;  // optional {c}
+  int side;       // default +1
+};
+
+void meridional_plane_ply (struct MeridionalPly p)
+{
+  if (!p.n) p.n = 512;
+  if (!p.side) p.side = 1;
+  if (!p.map) p.map = jet;
+  if (p.box[0].x == 0. && p.box[0].y == 0. &&
+      p.box[1].x == 0. && p.box[1].y == 0.) {
+    p.box[0].x = X0, p.box[0].y = Y0;
+    p.box[1].x = X0 + L0, p.box[1].y = Y0 + L0;
+  }
+  double dp = (p.box[1].x - p.box[0].x)/p.n;
+  int nx = p.n, ny = raster_pixels (p.box[1].y - p.box[0].y, dp);
+  long np = (long) nx*ny;
+  float * a = qmalloc (np, float), * mask = NULL;
+  raster_fill (p.s, a, nx, ny, p.box[0], dp, true);
+  if (p.mask) {
+    mask = qmalloc (np, float);
+    raster_fill (p.mask[0], mask, nx, ny, p.box[0], dp, true);
+  }
+  double cmap[NCMAP][3];
+  p.map (cmap);
+
+  PlyColorVertex * v = malloc (sizeof(PlyColorVertex)*np);
+  int * id = malloc (sizeof(int)*np);
+  long nv = 0;
+  for (long k = 0; k < np; k++) {
+    if (isnan (a[k])) {
+      id[k] = -1;
+      continue;
+    }
+    int ip = k % nx, jp = k/nx;
+    color c = colormap_color (cmap, a[k], p.min, p.max);
+    bool visible = !mask || mask[k] >= 0.5;
+    v[nv] = (PlyColorVertex){
+      p.side*(p.box[0].y + (jp + 0.5)*dp), 0., p.box[0].x + (ip + 0.5)*dp,
+      c.r, c.g, c.b, visible ? 255 : 0
+    };
+    id[k] = nv++;
+  }
+  PlyQuad * q = malloc (sizeof(PlyQuad)*np);
+  long nq = 0;
+  for (int jp = 0; jp < ny - 1; jp++)
+    for (int ip = 0; ip < nx - 1; ip++) {
+      long k = (long) jp*nx + ip;
+      int c[4] = {id[k], id[k + 1], id[k + nx + 1], id[k + nx]};
+      if (c[0] < 0 || c[1] < 0 || c[2] < 0 || c[3] < 0)
+	continue;
+      if (mask && !(mask[k] >= 0.5) && !(mask[k + 1] >= 0.5) &&
+	  !(mask[k + nx] >= 0.5) && !(mask[k + nx + 1] >= 0.5))
+	continue;
+      q[nq++] = (PlyQuad){4, {c[0], c[1], c[2], c[3]}};
+    }
+  ply_header (p.fp, nv, nq, true);
+  fwrite (v, sizeof(PlyColorVertex), nv, p.fp);
+  fwrite (q, sizeof(PlyQuad), nq, p.fp);
+  free (v), free (id), free (q), free (a), free (mask);
+}
+
+/**
+## In-situ export
+
+When this file is included in a simulation, the revolved interface and
+yield surface are written every `mesh_dt` to
+`intermediate/interface-<t>.ply` and `intermediate/yield-<t>.ply`. */
+
+double mesh_dt = 0.005;
+int mesh_steps = 64;
+
+event export_mesh (t = 0; t += mesh_dt)
+{
+  evp_diagnostics();
+  char name[80];
+  Segments s[2] = {interface_segments (f), yield_segments (solidreg, f)};
+  const char * base[2] = {"interface", "yield"};
+  for (int k = 0; k < 2; k++) {
+    Polylines l = segments_chain (&s[k]);
+    sprintf (name, "intermediate/%s-%5.4f.ply", base[k], t);
+    FILE * fp = fopen (name, "w");
+    revolve_ply (fp, &l, mesh_steps);
+    fclose (fp);
+    polylines_free (&l);
+    segments_free (&s[k]);
+  }
+}
@@ -0,0 +1,34 @@
+#!/bin/bash
+# Builds burst_evp in benchmark mode (see benchmark.h) and times all the
+# presets with pinned OpenMP threads.
+#
+# Usage (from 01_code):
+#   ./run-benchmarks.sh [threads] [steps] [label]
+#
+# The runs are done in bench/, where the checkpoints bench-<preset>.dump
+# are kept between builds, so that successive builds start from the same
+# states. The reports go to bench/<label>/benchmark-<preset>.json (the
+# label defaults to the git revision) and are compared with
+#   python3 compare-benchmarks.py bench/<label1> bench/<label2>
+set -e
+
+threads=${1:-4}
+steps=${2:-200}
+build=$(git describe --always --dirty 2>/dev/null || echo unknown)
+label=${3:-$build}
+
+qcc -O2 -Wall -disable-dimensions -fopenmp -DBENCHMARK=1 \
+    -DBENCH_BUILD="\"$build\"" burst_evp.c -o burst_evp_bench -lm
+
+mkdir -p bench/"$label"
+cp Bo0.0010.dat burst_evp_bench bench/
+cd bench
+
+export OMP_NUM_THREADS=$threads OMP_PROC_BIND=close OMP_PLACES=cores
+for preset in lowDe-highJ mid highDe; do
+    if [ ! -f bench-$preset.dump ]; then
+        ./burst_evp_bench $preset > /dev/null 2> prepare-$preset.log
+    fi
+    ./burst_evp_bench $preset $steps > /dev/null 2> "$label"/$preset.log
+    mv benchmark-$preset.json "$label"/
+done
@@ -0,0 +1,51 @@
+#!/bin/bash
+# Scaling of burst_evp over one and two sockets, with and without the
+# NUMA placement of numa.h, in benchmark mode (see benchmark.h).
+#
+# Usage (from 01_code):
+#   ./run-scaling.sh [preset] [steps]
+#
+# For 1 thread, the cores of one socket and the cores of all the
+# sockets, the preset is run with
+#   default   threads not pinned, cells where they were first touched
+#   compact   -DNUMA=1, NUMA_POLICY=compact: threads fill one socket first
+#   spread    -DNUMA=1, NUMA_POLICY=spread: threads split between the sockets
+# The reports go to bench/scaling/<variant>-<threads>/ and the table of
+# time per step, speed-up and efficiency is printed by scaling-table.py.
+set -e
+
+preset=${1:-mid}
+steps=${2:-100}
+sockets=$(lscpu -p=socket | grep -v '^#' | sort -u | wc -l)
+cores=$(lscpu -p=core,socket | grep -v '^#' | sort -u | wc -l)
+persocket=$((cores/sockets))
+
+qcc -O2 -Wall -disable-dimensions -fopenmp -DBENCHMARK=1 \
+    -DBENCH_BUILD="\"default\"" burst_evp.c -o burst_evp_bench -lm
+qcc -O2 -Wall -disable-dimensions -fopenmp -DBENCHMARK=1 -DNUMA=1 \
+    -DBENCH_BUILD="\"numa\"" burst_evp.c -o burst_evp_numa -lm
+
+mkdir -p bench/scaling
+cp Bo0.0010.dat burst_evp_bench burst_evp_numa bench/
+cd bench
+unset OMP_PROC_BIND OMP_PLACES
+if [ ! -f bench-$preset.dump ]; then
+    ./burst_evp_bench $preset > /dev/null 2> prepare-$preset.log
+fi
+
+for threads in $(echo 1 $persocket $cores | tr ' ' '\n' | sort -nu); do
+    for variant in default compact spread; do
+        if [ $variant = default ]; then
+            exe=./burst_evp_bench
+        else
+            exe=./burst_evp_numa
+        fi
+        dir=scaling/$variant-$threads
+        mkdir -p $dir
+        OMP_NUM_THREADS=$threads NUMA_POLICY=$variant \
+            $exe $preset $steps > /dev/null 2> $dir/$preset.log
+        mv benchmark-$preset.json $dir/
+    done
+done
+cd ..
+python3 scaling-table.py bench/scaling $preset $persocket
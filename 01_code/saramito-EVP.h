@@ -1,29 +1,10 @@
 /**
 # Functions $f_s$ and $f_r$ for the Saramito EVP model (Axi-symmetric case)
 
-See [log-conform-EVP.h](log-conform-EVP.h). */
+See [log-conform-EVP.h](log-conform-EVP.h). The functions themselves
+are in [saramito-kernels.h](saramito-kernels.h). */
 
-double L2 = 1.;
-double myeps=1e-6; //Tolerance
-
-static void saramito_r (double trA, double tau_pxx, double tau_pxy, double tau_pyy, double tau_qq, double tau00, double * nu, double * eta) {
-   double t1=tau_pxx;
-   double t2=tau_pxy;
-   double t3=tau_pyy;
-   double t4=tau_qq;    // Axi-symmetric case
-
-   double tauD=sqrt((1.0/6.0)*((t1-t3)*(t1-t3)+(t3-t4)*(t3-t4)+(t4-t1)*(t4-t1))+t2*t2);
-   double solid = max(0.0,(tauD-tau00)/(tauD+myeps));
-   *eta = solid;  // Switch term
-   *nu = 1.;
-  return;
-} 
-
-static void saramito_s (double trA, double tau_pxx, double tau_pxy, double tau_pyy, double tauqq, double tau00, double * nu, double * eta) {
-   *eta = 1.;
-   *nu = 1.;
-  return;
-}
+#include "saramito-kernels.h"
 
 event defaults (i = 0) {
   f_s = saramito_s;
@@ -36,7 +17,10 @@ event init (i = 0) {
 #else
   double dim = dimension;
 #endif  
+  evp_trA0 = dim*L2/(dim + L2);
+#if !EVP_LAZY_DIAGNOSTICS
   scalar trac = trA;
   foreach()
-    trac[] = dim*L2/(dim + L2);
+    trac[] = evp_trA0;
+#endif
 }
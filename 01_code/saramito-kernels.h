@@ -0,0 +1,37 @@
+/**
+# Saramito functions $f_s$ and $f_r$
+
+The functions installed by [saramito-EVP.h](saramito-EVP.h), in plain
+C so that they can be called outside of the grid (see
+[kernel-bench.c](kernel-bench.c)). $f_r$ returns the switch term
+$$
+\eta = \max\left(0, \frac{\tau_D - \tau_0}{\tau_D + \epsilon}\right)
+$$
+with $\tau_D$ the norm of the deviatoric stress (including the
+azimuthal component). */
+
+#ifndef max
+# define max(a,b) ((a) > (b) ? (a) : (b))
+#endif
+
+double L2 = 1.;
+double myeps=1e-6; //Tolerance
+
+static void saramito_r (double trA, double tau_pxx, double tau_pxy, double tau_pyy, double tau_qq, double tau00, double * nu, double * eta) {
+   double t1=tau_pxx;
+   double t2=tau_pxy;
+   double t3=tau_pyy;
+   double t4=tau_qq;    // Axi-symmetric case
+
+   double tauD=sqrt((1.0/6.0)*((t1-t3)*(t1-t3)+(t3-t4)*(t3-t4)+(t4-t1)*(t4-t1))+t2*t2);
+   double solid = max(0.0,(tauD-tau00)/(tauD+myeps));
+   *eta = solid;  // Switch term
+   *nu = 1.;
+  return;
+} 
+
+static void saramito_s (double trA, double tau_pxx, double tau_pxy, double tau_pyy, double tauqq, double tau00, double * nu, double * eta) {
+   *eta = 1.;
+   *nu = 1.;
+  return;
+}
@@ -0,0 +1,44 @@
+"""
+Prints the table of the scaling runs of run-scaling.sh:
+
+    python3 scaling-table.py bench/scaling <preset> [cores per socket]
+
+One line per variant and number of threads: time per step, cell
+updates per second, speed-up and parallel efficiency with respect to
+the default run on one thread, and the sockets used.
+"""
+import glob
+import json
+import os
+import sys
+
+
+def main(directory, preset, persocket=None):
+    runs = []
+    for path in glob.glob(os.path.join(directory, '*', f'benchmark-{preset}.json')):
+        variant = os.path.basename(os.path.dirname(path)).rsplit('-', 1)[0]
+        with open(path) as fp:
+            runs.append((variant, json.load(fp)))
+    if not runs:
+        sys.exit(f'no report of {preset} in {directory}')
+    ref = [r for v, r in runs if v == 'default' and r['threads'] == 1]
+    t1 = ref[0]['time_per_step'] if ref else None
+    print(f"{'variant':8s} {'threads':>7s} {'sockets':>7s} {'s/step':>10s} "
+          f"{'cells/s':>10s} {'speed-up':>8s} {'eff.':>6s}")
+    order = {'default': 0, 'compact': 1, 'spread': 2}
+    for v, r in sorted(runs, key=lambda x: (x[1]['threads'], order.get(x[0], 3))):
+        n, ts = r['threads'], r['time_per_step']
+        if persocket and v != 'default':
+            one = n == 1 or (v == 'compact' and n <= persocket)
+            sockets = '1' if one else '2'
+        else:
+            sockets = '-'
+        s = t1/ts if t1 else float('nan')
+        print(f"{v:8s} {n:7d} {sockets:>7s} {ts:10.4g} "
+              f"{r['cell_updates_per_second']:10.4g} {s:8.2f} {s/n:6.2f}")
+
+
+if __name__ == '__main__':
+    if len(sys.argv) not in (3, 4):
+        sys.exit(__doc__)
+    main(sys.argv[1], sys.argv[2], int(sys.argv[3]) if len(sys.argv) > 3 else None)
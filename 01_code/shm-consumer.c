@@ -0,0 +1,115 @@
+/**
+# Example consumer of the shared-memory frames
+
+Attaches to the ring published by [burst_evp.c](burst_evp.c) (see
+[shm-publish.h](shm-publish.h)) and, for each frame, writes one line
+
+~~~
+t i leaves pending volume ke vjet xtip yielded ms
+~~~
+
+with the number of frames still pending, the axisymmetric volume and
+kinetic energy of the liquid ($f > 1/2$ for the others), the largest
+axial velocity of the liquid on the axis, the axial position of the
+tip of the liquid on the axis, the yielded fraction of the liquid
+volume and the time spent on the frame. This is a template for heavier
+analyses (statistics, extraction, rendering) done off the critical
+path of the solver.
+
+~~~bash
+gcc -O2 -Wall shm-consumer.c -o shm-consumer -pthread -lrt -lm
+./shm-consumer [-w wait] [-s sleep] [-o output] [name]
+~~~
+
+`-w` waits at most `wait` seconds for the ring to appear (default
+60), `-s` adds `sleep` seconds per frame (to try the backpressure
+policies) and `name` is the ring (`/burst_evp` by default). The
+consumer stops when the producer has finished and all the frames have
+been read. */
+
+#include <math.h>
+#include <getopt.h>
+
+#include "shm-ring.h"
+
+static double wall()
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+int main (int argc, char * argv[])
+{
+  double wait = 60., nap = 0.;
+  FILE * out = stdout;
+  int opt;
+  while ((opt = getopt (argc, argv, "w:s:o:")) != -1)
+    switch (opt) {
+    case 'w': wait = atof (optarg); break;
+    case 's': nap = atof (optarg); break;
+    case 'o':
+      if (!(out = fopen (optarg, "w"))) {
+	perror (optarg);
+	return 1;
+      }
+      break;
+    default:
+      fprintf (stderr, "usage: %s [-w wait] [-s sleep] [-o output] [name]\n",
+	       argv[0]);
+      return 1;
+    }
+  const char * name = optind < argc ? argv[optind] : "/burst_evp";
+
+  ShmRing * r = NULL;
+  for (double t0 = wall(); !(r = shm_ring_open (name)); usleep (100000))
+    if (wall() - t0 > wait) {
+      fprintf (stderr, "%s: no ring\n", name);
+      return 1;
+    }
+
+  fprintf (out, "t i leaves pending volume ke vjet xtip yielded ms\n");
+  const ShmFrame * fr;
+  long frames = 0;
+  while ((fr = shm_ring_acquire (r, wait))) {
+    double start = wall();
+    const double * f = shm_frame_field (fr, "f");
+    const double * ux = shm_frame_field (fr, "u.x");
+    const double * uy = shm_frame_field (fr, "u.y");
+    const double * yield = shm_frame_field (fr, "solidreg");
+    double volume = 0., ke = 0., vjet = 0., xtip = - HUGE_VAL, yielded = 0.;
+    for (long k = 0; f && k < fr->nleaves; k++) {
+      double x, y, delta;
+      shm_frame_cell (fr, k, &x, &y, &delta);
+      double dv = 2.*M_PI*y*delta*delta;
+      volume += f[k]*dv;
+      if (ux && uy)
+	ke += 0.5*f[k]*(ux[k]*ux[k] + uy[k]*uy[k])*dv;
+      if (f[k] > 0.5) {
+	if (yield && yield[k] > 0.)
+	  yielded += dv;
+	if (y < delta) {
+	  if (ux && ux[k] > vjet)
+	    vjet = ux[k];
+	  if (x + delta/2. > xtip)
+	    xtip = x + delta/2.;
+	}
+      }
+    }
+    if (nap > 0.)
+      usleep (nap*1e6);
+    fprintf (out, "%g %d %ld %ld %g %g %g %g %g %.3g\n", fr->t, fr->i,
+	     (long) fr->nleaves, shm_ring_pending (r), volume, ke, vjet,
+	     xtip, volume > 0. ? yielded/volume : 0., 1e3*(wall() - start));
+    fflush (out);
+    shm_ring_release (r);
+    frames++;
+  }
+  fprintf (stderr, "%s: %ld frames, %ld published, %ld dropped, "
+	   "%ld overwritten\n", name, frames, (long) r->h->published,
+	   (long) r->h->dropped, (long) r->h->overwritten);
+  shm_ring_close (r);
+  if (out != stdout)
+    fclose (out);
+  return 0;
+}
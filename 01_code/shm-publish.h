@@ -0,0 +1,119 @@
+/**
+# In-transit analysis through shared memory
+
+Every `shm_dt`, the leaf cells (level and indices) and the fields of
+`shm_fields` are published as one frame of the shared-memory ring
+`shm_name` (see [shm-ring.h](shm-ring.h)). A consumer process on the
+same node maps the ring and analyses the frames while the solver goes
+on, without going through the file system; see
+[shm-consumer.c](shm-consumer.c).
+
+~~~bash
+./burst_evp 0.1 0.04 &
+./shm-consumer /burst_evp
+~~~
+
+The ring has `shm_slots` slots, sized at the first frame for
+`shm_margin` times its number of leaf cells (larger frames are
+dropped). `shm_policy` sets what happens when all the slots hold
+unread frames (`block`, `drop-new` or `drop-old`, see
+[shm-ring.h](shm-ring.h)); with `block` the solver waits for at most
+`shm_timeout` seconds. The name and the policy can be set with the
+environment variables `SHM_NAME` and `SHM_POLICY`.
+
+The cost of publishing (one pass over the leaf cells, copied into the
+slot) and the time spent waiting for the consumer are printed at the
+end of the run, with the number of frames published and dropped. */
+
+#include "shm-ring.h"
+
+const char * shm_name = "/burst_evp";
+const char * shm_policy = "block";   // block, drop-new or drop-old
+double shm_dt = 0.005;               // time between two frames
+double shm_timeout = 60.;            // longest wait for the consumer (s)
+double shm_margin = 4.;              // slot size, in leaf cells of the first frame
+int shm_slots = 4;
+scalar * shm_fields = NULL;          // default: f, u, p, the stress, solidreg
+
+static struct {
+  ShmRing * ring;
+  int policy;
+  bool failed;
+  double publish, wait;
+} shm;
+
+event shm_publish (t = 0; t += shm_dt)
+{
+  if (shm.failed)
+    return 0;
+  evp_diagnostics();
+  if (!shm_fields)
+    shm_fields = list_copy ((scalar *){f, u, p, tau_p.x.x, tau_p.x.y,
+				       tau_p.y.y, solidreg});
+  int nf = min (list_len (shm_fields), SHM_RING_MAXFIELDS);
+  long n = 0;
+  foreach (reduction(+:n))
+    n++;
+
+  if (!shm.ring) {
+    if (getenv ("SHM_NAME"))
+      shm_name = getenv ("SHM_NAME");
+    if (getenv ("SHM_POLICY"))
+      shm_policy = getenv ("SHM_POLICY");
+    shm.policy = !strcmp (shm_policy, "drop-new") ? SHM_DROP_NEW :
+      !strcmp (shm_policy, "drop-old") ? SHM_DROP_OLD : SHM_BLOCK;
+    shm.ring = shm_ring_create (shm_name, shm_slots,
+				shm_frame_bytes (shm_margin*n, nf));
+    if (!shm.ring) {
+      shm.failed = true;
+      return 0;
+    }
+    fprintf (ferr, "# shm: ring %s, %d slots of %.3g MB, policy %s\n",
+	     shm_name, shm_slots, shm.ring->h->slot_bytes/1e6, shm_policy);
+  }
+
+  timer tm = timer_start();
+  ShmFrame * fr = shm_ring_reserve (shm.ring, shm_frame_bytes (n, nf),
+				    shm.policy, shm_timeout);
+  shm.wait += timer_elapsed (tm);
+  if (!fr)
+    return 0;
+
+  tm = timer_start();
+  fr->t = t, fr->i = i, fr->nfields = nf, fr->nleaves = n;
+  fr->X0 = X0, fr->Y0 = Y0, fr->L0 = L0;
+  int k = 0;
+  for (scalar s in shm_fields)
+    if (k < nf)
+      strncpy (fr->names[k++], s.name, SHM_RING_NAMELEN - 1);
+  uint8_t * lev = shm_frame_level (fr);
+  int32_t * ix = shm_frame_index (fr, 0), * iy = shm_frame_index (fr, 1);
+  double * val[nf];
+  for (k = 0; k < nf; k++)
+    val[k] = shm_frame_values (fr, k);
+  long c = 0;
+  foreach (serial) {
+    lev[c] = level;
+    ix[c] = point.i - GHOSTS, iy[c] = point.j - GHOSTS;
+    k = 0;
+    for (scalar s in shm_fields)
+      if (k < nf)
+	val[k++][c] = s[];
+    c++;
+  }
+  shm_ring_commit (shm.ring);
+  shm.publish += timer_elapsed (tm);
+}
+
+event end (t = end)
+{
+  if (shm.ring) {
+    ShmRingHeader * h = shm.ring->h;
+    fprintf (ferr, "# shm: %ld frames published, %ld dropped (%ld too large), "
+	     "%ld overwritten; publish %g s, wait %g s\n",
+	     (long) h->published, (long) h->dropped, (long) h->oversize,
+	     (long) h->overwritten, shm.publish, shm.wait);
+    shm_ring_close (shm.ring);
+    shm.ring = NULL;
+  }
+}
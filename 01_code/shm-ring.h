@@ -0,0 +1,455 @@
+/**
+# Shared-memory ring of frames
+
+A POSIX shared-memory object holding `nslots` slots of `slot_bytes`,
+written by one producer ([shm-publish.h](shm-publish.h), in
+[burst_evp.c](burst_evp.c)) and read by one consumer process on the
+same node ([shm-consumer.c](shm-consumer.c) is an example). This file
+is plain C, included both by Basilisk code and by the consumers:
+
+~~~bash
+gcc -O2 -Wall my-consumer.c -o my-consumer -pthread -lrt -lm
+~~~
+
+A frame is the state of the leaf cells at one time: the level and the
+indices of each leaf cell (which define the tree) and the values of a
+few fields, as arrays of `nleaves` values:
+
+~~~c
+ShmRing * r = shm_ring_open ("/burst_evp");
+const ShmFrame * fr;
+while ((fr = shm_ring_acquire (r, 60.))) {
+  const double * f = shm_frame_field (fr, "f");
+  for (long k = 0; k < fr->nleaves; k++) {
+    double x, y, delta;
+    shm_frame_cell (fr, k, &x, &y, &delta);
+    ...
+  }
+  shm_ring_release (r);
+}
+shm_ring_close (r);
+~~~
+
+The frame returned by `shm_ring_acquire()` is read in place and stays
+valid until `shm_ring_release()`. `shm_ring_acquire()` returns `NULL`
+after a timeout (in seconds) or when the producer has finished and all
+the frames have been read.
+
+## Backpressure
+
+When all the slots hold unread frames, the producer applies one of the
+policies
+
+- `SHM_BLOCK`: wait until the consumer releases a frame, for at most
+  the timeout of the producer, then drop the new frame. Without a
+  consumer attached, the oldest frame is overwritten instead, so that
+  the latest frames are there when a consumer attaches,
+- `SHM_DROP_NEW`: drop the new frame,
+- `SHM_DROP_OLD`: overwrite the oldest unread frame (never the frame
+  being read).
+
+Frames larger than a slot are dropped. The counters of the header
+(published, dropped, overwritten, too large) are printed by the
+producer at the end of the run.
+
+Each slot is free, being written, ready or being read; the consumer
+takes the ready frames in the order of publication. The states are
+protected by a process-shared, robust mutex (a consumer which dies
+while holding it does not block the producer, and its slot is freed);
+the frames themselves are written and read without the lock. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define SHM_RING_MAGIC "EVPRING1"
+#define SHM_RING_MAXFIELDS 16
+#define SHM_RING_NAMELEN 32
+
+enum { SHM_BLOCK, SHM_DROP_NEW, SHM_DROP_OLD };
+
+typedef struct {
+  uint64_t seq;                 // number of the frame
+  uint64_t bytes;               // size of the frame, header included
+  double t;
+  int32_t i, nfields;
+  int64_t nleaves;
+  double X0, Y0, L0;            // domain
+  char names[SHM_RING_MAXFIELDS][SHM_RING_NAMELEN];
+} ShmFrame;
+
+#define SHM_RING_MAXSLOTS 64
+
+enum { SHM_FREE, SHM_WRITING, SHM_READY, SHM_READING };
+
+typedef struct {
+  char magic[8];
+  int32_t version, nslots;
+  uint64_t slot_bytes;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;          // published, released or closed
+  int32_t state[SHM_RING_MAXSLOTS];
+  uint64_t seq[SHM_RING_MAXSLOTS]; // frame held by each slot
+  uint64_t head;                // frames published
+  int32_t producer, consumer;   // pids, 0 if none
+  int32_t closed;
+  uint64_t published, dropped, overwritten, oversize;
+} ShmRingHeader;
+
+typedef struct {
+  ShmRingHeader * h;
+  char * slots;
+  size_t size;
+  char name[256];
+  int producer, slot;           // slot written or read by this process
+} ShmRing;
+
+/**
+## Frames
+
+The arrays follow the header, each aligned on 64 bytes: the levels
+(`uint8_t`), the indices $i$ and $j$ (`int32_t`) and the fields
+(`double`), in the order of `names`. */
+
+static inline size_t shm_align (size_t n)
+{
+  return (n + 63) & ~(size_t) 63;
+}
+
+static inline size_t shm_frame_bytes (long nleaves, int nfields)
+{
+  return shm_align (sizeof(ShmFrame)) + shm_align (nleaves) +
+    2*shm_align (nleaves*sizeof(int32_t)) +
+    nfields*shm_align (nleaves*sizeof(double));
+}
+
+static inline uint8_t * shm_frame_level (const ShmFrame * fr)
+{
+  return (uint8_t *) fr + shm_align (sizeof(ShmFrame));
+}
+
+static inline int32_t * shm_frame_index (const ShmFrame * fr, int dir)
+{
+  return (int32_t *) ((char *) shm_frame_level (fr) + shm_align (fr->nleaves) +
+		      dir*shm_align (fr->nleaves*sizeof(int32_t)));
+}
+
+static inline double * shm_frame_values (const ShmFrame * fr, int k)
+{
+  return (double *) ((char *) shm_frame_index (fr, 0) +
+		     2*shm_align (fr->nleaves*sizeof(int32_t)) +
+		     k*shm_align (fr->nleaves*sizeof(double)));
+}
+
+/**
+The values of field `name`, or `NULL`. */
+
+static inline const double * shm_frame_field (const ShmFrame * fr,
+					      const char * name)
+{
+  for (int k = 0; k < fr->nfields; k++)
+    if (!strncmp (fr->names[k], name, SHM_RING_NAMELEN))
+      return shm_frame_values (fr, k);
+  return NULL;
+}
+
+/**
+The centre and the size of leaf cell `k`. */
+
+static inline void shm_frame_cell (const ShmFrame * fr, long k,
+				   double * x, double * y, double * delta)
+{
+  double d = fr->L0/(1 << shm_frame_level (fr)[k]);
+  *x = fr->X0 + (shm_frame_index (fr, 0)[k] + 0.5)*d;
+  *y = fr->Y0 + (shm_frame_index (fr, 1)[k] + 0.5)*d;
+  *delta = d;
+}
+
+/**
+## Locking */
+
+static inline void shm_lock (ShmRing * r)
+{
+  if (pthread_mutex_lock (&r->h->lock) == EOWNERDEAD)
+    pthread_mutex_consistent (&r->h->lock);
+}
+
+static inline void shm_unlock (ShmRing * r)
+{
+  pthread_mutex_unlock (&r->h->lock);
+}
+
+static inline int shm_wait (ShmRing * r, const struct timespec * deadline)
+{
+  int ret = pthread_cond_timedwait (&r->h->cond, &r->h->lock, deadline);
+  if (ret == EOWNERDEAD) {
+    pthread_mutex_consistent (&r->h->lock);
+    ret = 0;
+  }
+  return ret;
+}
+
+static inline struct timespec shm_deadline (double timeout)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  double s = ts.tv_sec + ts.tv_nsec*1e-9 + (timeout > 0. ? timeout : 0.);
+  ts.tv_sec = s;
+  ts.tv_nsec = (s - ts.tv_sec)*1e9;
+  return ts;
+}
+
+static inline int shm_alive (int32_t pid)
+{
+  return pid > 0 && (kill (pid, 0) == 0 || errno == EPERM);
+}
+
+/**
+## Producer */
+
+static inline ShmRing * shm_ring_create (const char * name, int nslots,
+				  size_t slot_bytes)
+{
+  slot_bytes = shm_align (slot_bytes);
+  if (nslots > SHM_RING_MAXSLOTS)
+    nslots = SHM_RING_MAXSLOTS;
+  size_t head = (sizeof(ShmRingHeader) + 4095) & ~(size_t) 4095;
+  size_t size = head + nslots*slot_bytes;
+  shm_unlink (name);
+  int fd = shm_open (name, O_CREAT | O_RDWR | O_EXCL, 0600);
+  if (fd < 0) {
+    perror (name);
+    return NULL;
+  }
+  if (ftruncate (fd, size)) {
+    perror (name);
+    close (fd);
+    shm_unlink (name);
+    return NULL;
+  }
+  void * p = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close (fd);
+  if (p == MAP_FAILED) {
+    perror (name);
+    shm_unlink (name);
+    return NULL;
+  }
+
+  ShmRing * r = calloc (1, sizeof(ShmRing));
+  r->h = p, r->slots = (char *) p + head, r->size = size, r->producer = 1;
+  snprintf (r->name, sizeof(r->name), "%s", name);
+
+  ShmRingHeader * h = r->h;
+  memset (h, 0, sizeof(ShmRingHeader));
+  pthread_mutexattr_t ma;
+  pthread_mutexattr_init (&ma);
+  pthread_mutexattr_setpshared (&ma, PTHREAD_PROCESS_SHARED);
+  pthread_mutexattr_setrobust (&ma, PTHREAD_MUTEX_ROBUST);
+  pthread_mutex_init (&h->lock, &ma);
+  pthread_mutexattr_destroy (&ma);
+  pthread_condattr_t ca;
+  pthread_condattr_init (&ca);
+  pthread_condattr_setpshared (&ca, PTHREAD_PROCESS_SHARED);
+  pthread_condattr_setclock (&ca, CLOCK_MONOTONIC);
+  pthread_cond_init (&h->cond, &ca);
+  pthread_condattr_destroy (&ca);
+  h->version = 1, h->slot_bytes = slot_bytes;
+  h->nslots = nslots < 1 ? 1 : nslots > SHM_RING_MAXSLOTS ? SHM_RING_MAXSLOTS : nslots;
+  h->producer = getpid();
+  __atomic_thread_fence (__ATOMIC_SEQ_CST);
+  memcpy (h->magic, SHM_RING_MAGIC, 8);
+  return r;
+}
+
+/**
+The ready slot holding the oldest frame, or -1. */
+
+static inline int shm_oldest (ShmRingHeader * h)
+{
+  int k = -1;
+  for (int j = 0; j < h->nslots; j++)
+    if (h->state[j] == SHM_READY && (k < 0 || h->seq[j] < h->seq[k]))
+      k = j;
+  return k;
+}
+
+static inline ShmFrame * shm_slot (ShmRing * r, int k)
+{
+  return (ShmFrame *) (r->slots + k*r->h->slot_bytes);
+}
+
+/**
+Returns the slot of the next frame, or `NULL` if the frame is dropped.
+The frame is visible to the consumer after `shm_ring_commit()`. */
+
+static inline ShmFrame * shm_ring_reserve (ShmRing * r, size_t bytes,
+					   int policy, double timeout)
+{
+  ShmRingHeader * h = r->h;
+  shm_lock (r);
+  if (bytes > h->slot_bytes) {
+    h->oversize++, h->dropped++;
+    shm_unlock (r);
+    return NULL;
+  }
+  struct timespec deadline = shm_deadline (timeout);
+  r->slot = -1;
+  while (r->slot < 0) {
+    int attached = shm_alive (h->consumer);
+    for (int j = 0; j < h->nslots && r->slot < 0; j++)
+      if (h->state[j] == SHM_FREE ||
+	  (h->state[j] == SHM_READING && !attached)) // the consumer died
+	r->slot = j;
+    if (r->slot >= 0)
+      break;
+    if (policy == SHM_BLOCK && attached) {
+      if (shm_wait (r, &deadline) == ETIMEDOUT)
+	break;
+    }
+    else if (policy == SHM_DROP_NEW)
+      break;
+    else if ((r->slot = shm_oldest (h)) >= 0)
+      h->overwritten++;
+    else
+      break;
+  }
+  if (r->slot < 0) {
+    h->dropped++;
+    shm_unlock (r);
+    return NULL;
+  }
+  h->state[r->slot] = SHM_WRITING;
+  shm_unlock (r);
+  ShmFrame * fr = shm_slot (r, r->slot);
+  memset (fr, 0, sizeof(ShmFrame));
+  fr->bytes = bytes;
+  return fr;
+}
+
+static inline void shm_ring_commit (ShmRing * r)
+{
+  ShmRingHeader * h = r->h;
+  shm_lock (r);
+  shm_slot (r, r->slot)->seq = h->head;
+  h->seq[r->slot] = h->head++;
+  h->state[r->slot] = SHM_READY;
+  h->published++;
+  pthread_cond_broadcast (&h->cond);
+  shm_unlock (r);
+}
+
+/**
+## Consumer
+
+`shm_ring_open()` returns `NULL` if there is no ring `name` (yet) or
+if another consumer is attached. */
+
+static inline ShmRing * shm_ring_open (const char * name)
+{
+  int fd = shm_open (name, O_RDWR, 0);
+  if (fd < 0)
+    return NULL;
+  struct stat st;
+  if (fstat (fd, &st) || st.st_size < (off_t) sizeof(ShmRingHeader)) {
+    close (fd);
+    return NULL;
+  }
+  void * p = mmap (NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close (fd);
+  if (p == MAP_FAILED)
+    return NULL;
+  ShmRingHeader * h = p;
+  if (strncmp (h->magic, SHM_RING_MAGIC, 8) || h->version != 1) {
+    munmap (p, st.st_size);
+    return NULL;
+  }
+  ShmRing * r = calloc (1, sizeof(ShmRing));
+  r->h = h, r->size = st.st_size;
+  r->slots = (char *) p + ((sizeof(ShmRingHeader) + 4095) & ~(size_t) 4095);
+  snprintf (r->name, sizeof(r->name), "%s", name);
+  shm_lock (r);
+  if (shm_alive (h->consumer) && h->consumer != getpid()) {
+    shm_unlock (r);
+    fprintf (stderr, "%s: a consumer (pid %d) is already attached\n",
+	     name, h->consumer);
+    munmap (p, r->size);
+    free (r);
+    return NULL;
+  }
+  h->consumer = getpid(), r->slot = -1;
+  for (int j = 0; j < h->nslots; j++)
+    if (h->state[j] == SHM_READING)   // left by a previous consumer
+      h->state[j] = SHM_FREE;
+  shm_unlock (r);
+  return r;
+}
+
+static inline const ShmFrame * shm_ring_acquire (ShmRing * r, double timeout)
+{
+  ShmRingHeader * h = r->h;
+  struct timespec deadline = shm_deadline (timeout);
+  shm_lock (r);
+  while ((r->slot = shm_oldest (h)) < 0 && !h->closed)
+    if (shm_wait (r, &deadline) == ETIMEDOUT)
+      break;
+  if (r->slot >= 0)
+    h->state[r->slot] = SHM_READING;
+  shm_unlock (r);
+  return r->slot >= 0 ? shm_slot (r, r->slot) : NULL;
+}
+
+static inline void shm_ring_release (ShmRing * r)
+{
+  shm_lock (r);
+  if (r->slot >= 0 && r->h->state[r->slot] == SHM_READING)
+    r->h->state[r->slot] = SHM_FREE;
+  r->slot = -1;
+  pthread_cond_broadcast (&r->h->cond);
+  shm_unlock (r);
+}
+
+/**
+Number of frames published and not read yet. */
+
+static inline long shm_ring_pending (ShmRing * r)
+{
+  long n = 0;
+  shm_lock (r);
+  for (int j = 0; j < r->h->nslots; j++)
+    n += r->h->state[j] == SHM_READY;
+  shm_unlock (r);
+  return n;
+}
+
+/**
+The producer marks the ring as closed (the consumer reads the
+remaining frames) and removes its name; the memory is freed when both
+processes have unmapped it. */
+
+static inline void shm_ring_close (ShmRing * r)
+{
+  if (!r)
+    return;
+  shm_lock (r);
+  if (r->producer) {
+    r->h->closed = 1;
+    r->h->producer = 0;
+  }
+  else if (r->h->consumer == getpid())
+    r->h->consumer = 0;
+  pthread_cond_broadcast (&r->h->cond);
+  shm_unlock (r);
+  if (r->producer)
+    shm_unlink (r->name);
+  munmap (r->h, r->size);
+  free (r);
+}
@@ -0,0 +1,142 @@
+/**
+# Surface tension with a cached curvature
+
+This is [tension.h](http://basilisk.fr/src/tension.h) where the
+interface curvature is computed at most once per time step. The
+surface-tension force needs $\kappa$ in the acceleration event and
+`burst_evp.c` uses the same $\kappa$ as a refinement criterion in the
+adapt event. The volume fraction does not change in between, so both
+use the field returned by `interface_curvature()`.
+
+The cache is a temporary field, as the curvature of
+[tension.h](http://basilisk.fr/src/tension.h): it is allocated by the
+first call after the volume fraction is advected and deleted in the
+next vof event, so it is not a permanent field. It is never dumped
+(which also keeps it out of the field list of tools which include this
+header and restore dumps, such as `restore_batch.c`). Adaptation does
+not prolongate it into new cells: it is only read before the tree
+changes, between the acceleration and adapt events of the same step.
+`curvature()` sets the `refine` method of its target to
+`curvature_prolongation()`, so the no-op method is set again after
+each computation.
+
+The number of curvatures computed and reused, and the time spent
+computing them, are printed at the end of the run. Each reuse saves
+one computation, i.e. the mean time per computation.
+
+The surface tension is still applied as the interfacial force
+$\phi\nabla f$ of [iforce.h](http://basilisk.fr/src/iforce.h) with
+$\phi = \sigma\kappa$. */
+
+#include "iforce.h"
+#include "curvature.h"
+
+attribute {
+  double sigma;
+}
+
+scalar kappa_cache;
+static bool kappa_allocated = false, kappa_valid = false;
+static int kappa_field = -1;
+static struct {
+  int computed, reused;
+  double time;
+} kappa_stats;
+
+static void kappa_refine (Point point, scalar s) {}
+
+/**
+Returns the (cached) curvature of the interface defined by `c`. Only
+one interface is cached. */
+
+scalar interface_curvature (scalar c)
+{
+  assert (kappa_field < 0 || kappa_field == c.i);
+  if (!kappa_allocated) {
+    kappa_cache = new scalar;
+    kappa_cache.nodump = true;
+    kappa_allocated = true;
+  }
+  if (!kappa_valid || kappa_field != c.i) {
+    timer tm = timer_start();
+    curvature (c, kappa_cache);
+    kappa_cache.refine = kappa_refine;
+    kappa_stats.time += timer_elapsed (tm);
+    kappa_stats.computed++;
+    kappa_valid = true;
+    kappa_field = c.i;
+  }
+  else
+    kappa_stats.reused++;
+  return kappa_cache;
+}
+
+event vof (i++)
+{
+  if (kappa_allocated) {
+    delete ({kappa_cache});
+    kappa_allocated = false;
+  }
+  kappa_valid = false;
+}
+
+event end (t = end)
+{
+  if (kappa_stats.computed)
+    fprintf (ferr, "# curvature: %d computed, %d reused, %g s computing "
+	     "(%g s saved)\n", kappa_stats.computed, kappa_stats.reused,
+	     kappa_stats.time,
+	     kappa_stats.reused*kappa_stats.time/kappa_stats.computed);
+}
+
+/**
+## Stability condition
+
+The surface tension scheme is time-explicit so the maximum timestep is
+the oscillation period of the smallest capillary wave. */
+
+event stability (i++)
+{
+  double amin = HUGE, amax = -HUGE, dmin = HUGE;
+  foreach_face (reduction(min:amin) reduction(max:amax) reduction(min:dmin))
+    if (fm.x[] > 0.) {
+      if (alpha.x[]/fm.x[] > amax) amax = alpha.x[]/fm.x[];
+      if (alpha.x[]/fm.x[] < amin) amin = alpha.x[]/fm.x[];
+      if (Delta < dmin) dmin = Delta;
+    }
+  double rhom = (1./amin + 1./amax)/2.;
+
+  for (scalar c in interfaces)
+    if (c.sigma) {
+      double dt = sqrt (rhom*cube(dmin)/(pi*c.sigma));
+      if (dt < dtmax)
+	dtmax = dt;
+    }
+}
+
+/**
+## Definition of the potential
+
+The potential $\phi = \sigma\kappa$ is filled from the cached
+curvature. If another module already defined a potential, the
+surface-tension contribution is added to it. */
+
+event acceleration (i++)
+{
+  for (scalar f in interfaces)
+    if (f.sigma) {
+      scalar kappa = interface_curvature (f);
+      scalar phi = f.phi;
+      if (phi.i)
+	foreach() {
+	  if (kappa[] < nodata)
+	    phi[] = (phi[] < nodata ? phi[] : 0.) + f.sigma*kappa[];
+	}
+      else {
+	phi = new scalar;
+	foreach()
+	  phi[] = kappa[] < nodata ? f.sigma*kappa[] : nodata;
+	f.phi = phi;
+      }
+    }
+}
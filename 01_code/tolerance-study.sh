@@ -0,0 +1,32 @@
+#!/bin/bash
+# Runs one case with the fixed solver tolerance and with the adaptive
+# tolerance of adaptive-tolerance.h, and compares the two runs.
+#
+# Usage (from 01_code):
+#   ./tolerance-study.sh [J] [De] [threads] [stop]
+#
+# The runs are done in study/J<J>-De<De>/{fixed,adaptive}; stop is the
+# milestone which ends both runs (default "rest", see milestones.h).
+# The comparison is printed by
+#   python3 compare-tolerance.py study/J<J>-De<De>/fixed study/J<J>-De<De>/adaptive
+set -e
+
+J=${1:-0.1}
+De=${2:-0.04}
+threads=${3:-4}
+stop=${4:-rest}
+
+qcc -O2 -Wall -disable-dimensions -fopenmp -DSOLVER_LOG=1 \
+    burst_evp.c -o burst_evp_fixed -lm
+qcc -O2 -Wall -disable-dimensions -fopenmp -DSOLVER_LOG=1 -DADAPTIVE_TOLERANCE=1 \
+    burst_evp.c -o burst_evp_adaptive -lm
+
+dir=study/J$J-De$De
+export OMP_NUM_THREADS=$threads OMP_PROC_BIND=close OMP_PLACES=cores
+for mode in fixed adaptive; do
+    mkdir -p $dir/$mode
+    cp Bo0.0010.dat burst_evp_$mode $dir/$mode/
+    (cd $dir/$mode && /usr/bin/time -p ./burst_evp_$mode $J $De $stop \
+         > out 2> err)
+done
+python3 compare-tolerance.py $dir/fixed $dir/adaptive
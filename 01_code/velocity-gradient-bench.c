@@ -0,0 +1,117 @@
+/**
+# Microbenchmark of the velocity-gradient kernels
+
+Compares, on an adaptive axisymmetric tree with an analytical velocity
+field, the two-pass computation of the invariants used before by the
+extractors (face fields first, then averaged in each cell) with the
+one-pass kernel `face_averaged_invariants()` of
+[velocity-gradient.h](velocity-gradient.h). The centred kernel used by
+the solver and the in-situ diagnostics is timed as well.
+
+Outputs the number of leaf cells, the time per pass and per cell, and
+the largest relative difference between the two-pass and one-pass
+results (round-off away from resolution boundaries; at a boundary the
+two-pass version uses the face values of the finer side).
+
+~~~bash
+qcc -O2 -Wall -disable-dimensions -fopenmp velocity-gradient-bench.c -o vgbench -lm
+OMP_NUM_THREADS=8 ./vgbench 11 20
+~~~
+*/
+
+#include "axi.h"
+#include "velocity-gradient.h"
+
+vector u[];
+scalar DD[], SS[], DD1[], SS1[], DDc[];
+
+static void two_pass()
+{
+  face vector DDf[], SSf[];
+  foreach_face(x) {
+    double D11 = 0.5*( (u.y[0,1] - u.y[0,-1] + u.y[-1,1] - u.y[-1,-1])/(2.*Delta) );
+    double D22 = (u.y[] + u.y[-1, 0])/(2*max(y, 1e-20));
+    double D33 = (u.x[] - u.x[-1,0])/Delta;
+    double D13 = 0.5*( (u.y[] - u.y[-1, 0])/Delta + 0.5*( (u.x[0,1] - u.x[0,-1] + u.x[-1,1] - u.x[-1,-1])/(2.*Delta) ) );
+    DDf.x[] = sq(D11) + sq(D22) + sq(D33) + 2*sq(D13);
+    double O13 = 0.5*( (u.y[] - u.y[-1, 0])/Delta - 0.5*( (u.x[0,1] - u.x[0,-1] + u.x[-1,1] - u.x[-1,-1])/(2.*Delta) ) );
+    SSf.x[] = 2.*sq(O13);
+  }
+  foreach_face(y) {
+    double D11 = (u.y[0,0] - u.y[0,-1])/Delta;
+    double D22 = (u.y[0,0] + u.y[0,-1])/(2*max(y, 1e-20));
+    double D33 = 0.5*( (u.x[1,0] - u.x[-1,0] + u.x[1,-1] - u.x[-1,-1])/(2.*Delta) );
+    double D13 = 0.5*( (u.x[0,0] - u.x[0,-1])/Delta + 0.5*( (u.y[1,0] - u.y[-1,0] + u.y[1,-1] - u.y[-1,-1])/(2.*Delta) ) );
+    DDf.y[] = sq(D11) + sq(D22) + sq(D33) + 2*sq(D13);
+    double O13 = 0.5*( (u.x[0,0] - u.x[0,-1])/Delta - 0.5*( (u.y[1,0] - u.y[-1,0] + u.y[1,-1] - u.y[-1,-1])/(2.*Delta) ) );
+    SSf.y[] = 2.*sq(O13);
+  }
+  foreach() {
+    DD[] = (DDf.x[] + DDf.y[] + DDf.x[1,0] + DDf.y[0,1])/4.;
+    SS[] = (SSf.x[] + SSf.y[] + SSf.x[1,0] + SSf.y[0,1])/4.;
+  }
+}
+
+static void one_pass()
+{
+  foreach() {
+    vgrad_invariants v = face_averaged_invariants (point, u);
+    DD1[] = v.DD, SS1[] = v.SS;
+  }
+}
+
+static void centred()
+{
+  foreach() {
+    vgrad gu = velocity_gradient (point, u, 1./(2.*Delta));
+    DDc[] = vgrad_DD (gu);
+  }
+}
+
+int main (int argc, char * argv[])
+{
+  int maxlevel = argc > 1 ? atoi (argv[1]) : 10;
+  int nrep = argc > 2 ? atoi (argv[2]) : 10;
+
+  L0 = 8.;
+  origin (-L0/2., 0.);
+  init_grid (1 << 6);
+
+  /**
+  The tree is refined to `maxlevel` in a band around a cavity-like
+  circle, as around the interface of the bubble. */
+
+  refine (fabs (sqrt (sq(x + 1.) + sq(y)) - 1.) < 0.1 && level < maxlevel);
+  foreach() {
+    u.x[] = sin (2.*x)*cos (y) + 0.1*x*y;
+    u.y[] = y*exp (- sq(x + 1.) - sq(y));
+  }
+
+  long n = 0;
+  foreach (reduction(+:n))
+    n++;
+
+  struct { const char * name; void (* f) (void); } k[] = {
+    {"face-then-cell (two passes)", two_pass},
+    {"face-averaged (one pass)", one_pass},
+    {"centred (one pass)", centred},
+  };
+  for (int j = 0; j < 3; j++) {
+    k[j].f(); // warm-up
+    timer tm = timer_start();
+    for (int r = 0; r < nrep; r++)
+      k[j].f();
+    double s = timer_elapsed (tm)/nrep;
+    fprintf (stderr, "%-28s %10.3g s/pass %8.3g ns/cell\n",
+	     k[j].name, s, 1e9*s/n);
+  }
+
+  double err = 0.;
+  foreach (reduction(max:err)) {
+    double e = max (fabs (DD1[] - DD[])/(DD[] + 1e-30),
+		    fabs (SS1[] - SS[])/(SS[] + 1e-30));
+    if (e > err)
+      err = e;
+  }
+  fprintf (stderr, "%ld leaf cells, max relative difference %g\n", n, err);
+}
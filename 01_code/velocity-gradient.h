@@ -0,0 +1,136 @@
+/**
+# Velocity-gradient invariants
+
+The velocity gradient of a cell and its invariants are needed by the
+solver ([log-conform-EVP.h](log-conform-EVP.h)), by the in-situ
+diagnostics ([energy-budget.h](energy-budget.h),
+[flow-topology.h](flow-topology.h)) and by the extractors of
+`04_graphical_abstract/`. They all use the functions below, which only
+read the $3\times 3$ velocity stencil of the cell and return plain
+values, so that everything is computed in a single traversal and
+without temporary fields.
+
+The components are $g_{ij} = \partial u_i/\partial x_j$ and, in the
+axisymmetric case, the hoop component $g_{\theta\theta} = u_y/y$. */
+
+typedef struct {
+  double xx, xy, yx, yy, qq;
+} vgrad;
+
+/**
+Centred differences in the cell, multiplied by `scale`: the gradient
+for `scale` $= 1/(2\Delta)$, the undivided differences (`xy` is
+$u_x[0,1] - u_x[0,-1]$) used by the log-conformation kernels for
+`scale` $= 1$. The hoop component is never scaled. */
+
+static inline vgrad velocity_gradient (Point point, vector u, double scale)
+{
+  vgrad gu;
+  gu.xx = scale*(u.x[1,0] - u.x[-1,0]);
+  gu.xy = scale*(u.x[0,1] - u.x[0,-1]);
+  gu.yx = scale*(u.y[1,0] - u.y[-1,0]);
+  gu.yy = scale*(u.y[0,1] - u.y[0,-1]);
+#if AXI
+  gu.qq = u.y[]/max(y, 1e-20);
+#else
+  gu.qq = 0.;
+#endif
+  return gu;
+}
+
+/**
+Gradient on the left (`d = 0`) or right (`d = 1`) face of the cell,
+with the compact normal difference and the tangential difference
+averaged over the two cells sharing the face. */
+
+static inline vgrad velocity_gradient_face_x (Point point, vector u, int d)
+{
+  vgrad gu;
+  gu.xx = (u.x[d,0] - u.x[d-1,0])/Delta;
+  gu.yx = (u.y[d,0] - u.y[d-1,0])/Delta;
+  gu.xy = (u.x[d,1] - u.x[d,-1] + u.x[d-1,1] - u.x[d-1,-1])/(4.*Delta);
+  gu.yy = (u.y[d,1] - u.y[d,-1] + u.y[d-1,1] - u.y[d-1,-1])/(4.*Delta);
+#if AXI
+  gu.qq = (u.y[d,0] + u.y[d-1,0])/(2.*max(y, 1e-20));
+#else
+  gu.qq = 0.;
+#endif
+  return gu;
+}
+
+/**
+Same on the bottom (`d = 0`) or top (`d = 1`) face. */
+
+static inline vgrad velocity_gradient_face_y (Point point, vector u, int d)
+{
+  vgrad gu;
+  gu.xy = (u.x[0,d] - u.x[0,d-1])/Delta;
+  gu.yy = (u.y[0,d] - u.y[0,d-1])/Delta;
+  gu.xx = (u.x[1,d] - u.x[-1,d] + u.x[1,d-1] - u.x[-1,d-1])/(4.*Delta);
+  gu.yx = (u.y[1,d] - u.y[-1,d] + u.y[1,d-1] - u.y[-1,d-1])/(4.*Delta);
+#if AXI
+  gu.qq = (u.y[0,d] + u.y[0,d-1])/(2.*max(y + (d - 0.5)*Delta, 1e-20));
+#else
+  gu.qq = 0.;
+#endif
+  return gu;
+}
+
+/**
+$\mathcal{D}:\mathcal{D}$ and $\mathcal{S}:\mathcal{S}$ for the
+rate-of-deformation $\mathcal{D} = (\nabla u + \nabla u^T)/2$ and
+rotation $\mathcal{S} = (\nabla u - \nabla u^T)/2$ tensors. These are
+plain arithmetic and vectorize in loops over packed arrays. */
+
+static inline double vgrad_DD (vgrad gu)
+{
+  return sq(gu.xx) + sq(gu.yy) + sq(gu.qq) + sq(gu.xy + gu.yx)/2.;
+}
+
+static inline double vgrad_SS (vgrad gu)
+{
+  return sq(gu.xy - gu.yx)/2.;
+}
+
+/**
+The flow-topology parameter (see
+`03_supplementary_plots/0[12]_flow_topology_definition_*`) from the
+norms $\|\mathcal{D}\| = \sqrt{\mathcal{D}:\mathcal{D}/2}$ and
+$\|\mathcal{S}\| = \sqrt{\mathcal{S}:\mathcal{S}/2}$, with
+$\mathcal{Q} = 1$ where the flow is idle. */
+
+static inline double topology_Q1 (double Dn, double Sn)
+{
+  return sq(Dn) + sq(Sn) > 0. ? (sq(Dn) - sq(Sn))/(sq(Dn) + sq(Sn)) : 1.;
+}
+
+static inline double topology_Q2 (double Dn, double Sn)
+{
+  return Dn + Sn > 0. ? (Dn - Sn)/(Dn + Sn) : 1.;
+}
+
+/**
+Invariants averaged over the four faces of the cell, as computed
+before in two passes by the extractors (face fields first, then their
+average in each cell): `DD` and `SS` are the averages of
+$\mathcal{D}:\mathcal{D}$ and $\mathcal{S}:\mathcal{S}$, `Dn` the
+average of $\sqrt{\mathcal{D}:\mathcal{D}}$. */
+
+typedef struct {
+  double DD, SS, Dn;
+} vgrad_invariants;
+
+static inline vgrad_invariants face_averaged_invariants (Point point,
+							 vector u)
+{
+  vgrad_invariants v = {0., 0., 0.};
+  for (int d = 0; d <= 1; d++) {
+    vgrad gu[2] = {velocity_gradient_face_x (point, u, d),
+		   velocity_gradient_face_y (point, u, d)};
+    for (int k = 0; k < 2; k++) {
+      double DD = vgrad_DD (gu[k]);
+      v.DD += DD/4., v.SS += vgrad_SS (gu[k])/4., v.Dn += sqrt(DD)/4.;
+    }
+  }
+  return v;
+}
@@ -0,0 +1,67 @@
+import bpy
+
+# Loads the meshes written by export_mesh (or in situ by revolve-mesh.h)
+# instead of building them in Blender as in blender_script.py.
+path = '/destination_path/'
+
+
+def import_ply(filepath):
+    if hasattr(bpy.ops.wm, 'ply_import'):      # Blender >= 3.6
+        bpy.ops.wm.ply_import(filepath=filepath)
+    else:
+        bpy.ops.import_mesh.ply(filepath=filepath)
+    return bpy.context.selected_objects[0]
+
+
+def glossy_material(name, color):
+    mat = bpy.data.materials.new(name=name)
+    mat.use_nodes = True
+    bsdf = mat.node_tree.nodes["Principled BSDF"]
+    bsdf.inputs['Base Color'].default_value = color
+    bsdf.inputs['Roughness'].default_value = 0.05
+    return mat
+
+
+def vertex_color_material(name, layer):
+    mat = bpy.data.materials.new(name=name)
+    mat.use_nodes = True
+    bsdf = mat.node_tree.nodes["Principled BSDF"]
+    color_input = mat.node_tree.nodes.new(type="ShaderNodeVertexColor")
+    color_input.layer_name = layer
+    mat.node_tree.links.new(color_input.outputs["Color"], bsdf.inputs["Base Color"])
+    mat.node_tree.links.new(color_input.outputs["Alpha"], bsdf.inputs["Alpha"])
+    mat.blend_method = 'BLEND'
+    mat.shadow_method = 'NONE'
+    return mat
+
+
+obj = import_ply(f'{path}/interface.ply')
+obj.data.materials.append(glossy_material("Interface", (8./255., 65./255., 123./255., 1)))
+
+obj = import_ply(f'{path}/yield.ply')
+obj.data.materials.append(glossy_material("Yield_Surface", (0., 0.8, 1., 1)))
+
+for name in ['plane-tp', 'plane-yield']:
+    obj = import_ply(f'{path}/{name}.ply')
+    layer = obj.data.color_attributes[0].name
+    obj.data.materials.append(vertex_color_material(f'{name}_Material', layer))
+
+bpy.context.scene.render.engine = 'CYCLES'
+bpy.context.scene.cycles.samples = 128
+bpy.context.scene.render.image_settings.file_format = 'PNG'
+
+light_data = bpy.data.lights.new(name="Light", type='POINT')
+light_object = bpy.data.objects.new("Light", light_data)
+bpy.context.collection.objects.link(light_object)
+light_object.location = (0, -5, 5)
+light_data.energy = 1000
+
+camera = bpy.data.objects['Camera']
+camera.location = (-4, -6, 1.5)
+camera.rotation_euler = (1.39626, 0, -0.523599)
+
+output_filepath = f"{path}/blender_render_ply.png"
+bpy.context.scene.render.filepath = output_filepath
+bpy.ops.render.render(write_still=True)
+
+print(f"Rendered image saved at {output_filepath}")
@@ -0,0 +1,44 @@
+"""
+Reader for the contour files written in situ by 01_code/contours.h
+(intermediate/contours-<t>).
+
+    c = load_contours('intermediate/contours-0.9500')
+    for xy, closed in c['surfaces']['interface']:
+        plt.plot(xy[:, 0], xy[:, 1])     # xy[k] = (x, y) of point k
+
+The interface and the yield surface are ordered polylines, so they can
+be plotted, revolved or compared between times without reconstructing
+them from the VOF field.
+"""
+import numpy as np
+
+MAGIC = b'EVPCONT1'
+NAMELEN = 16
+
+
+def load_contours(path):
+    with open(path, 'rb') as fp:
+        data = fp.read()
+    if data[:8] != MAGIC:
+        raise ValueError(f'{path}: not a contour file')
+    t = np.frombuffer(data, dtype=np.float64, count=1, offset=8)[0]
+    nsurf = int(np.frombuffer(data, dtype=np.int32, count=1, offset=16)[0])
+    offset = 20
+    surfaces = {}
+    for _ in range(nsurf):
+        name = data[offset:offset + NAMELEN].split(b'\0')[0].decode()
+        offset += NAMELEN
+        n = int(np.frombuffer(data, dtype=np.int32, count=1, offset=offset)[0])
+        offset += 4
+        counts = np.frombuffer(data, dtype=np.int32, count=n, offset=offset)
+        offset += 4*n
+        npoints = int(np.abs(counts).sum())
+        xy = np.frombuffer(data, dtype=np.float32, count=2*npoints,
+                           offset=offset).reshape(npoints, 2)
+        offset += 8*npoints
+        polylines, start = [], 0
+        for c in counts:
+            polylines.append((xy[start:start + abs(c)], bool(c < 0)))
+            start += abs(c)
+        surfaces[name] = polylines
+    return {'t': t, 'surfaces': surfaces}
@@ -0,0 +1,134 @@
+/**
+ * @file export_mesh.c
+ * @brief Writes the 3D render meshes of a snapshot as binary PLY files.
+ *
+ * Replaces the preparation done by blender_script.py (revolving
+ * interface-*.dat and triangulating blender_data.txt and
+ * blender_index_data.txt on every render) by ready-made meshes, see
+ * 01_code/revolve-mesh.h:
+ *   interface.ply  revolved interface
+ *   yield.ply      revolved yield surface
+ *   plane-tp.ply   meridional plane (X < 0) coloured by log10 tr(tau_p)
+ *                  (hot, -1.3 to 0.1), gas transparent
+ *   plane-yield.ply meridional plane (X > 0) coloured by solidreg
+ *                  (RdBu, -1 to 1), gas transparent
+ *
+ * Usage:
+ *   ./export_mesh [-n resolution] [-s steps] [-o outdir] B J Deb snapshot
+ *
+ * Compile (from this directory):
+ *   qcc -O2 -Wall -disable-dimensions -I../01_code export_mesh.c -o export_mesh -lm
+ *
+ * The meshes are loaded in Blender with blender_import_ply.py.
+ */
+
+#include <getopt.h>
+
+#include "axi.h"
+#include "navier-stokes/centered.h"
+#include "two-phase.h"
+#include "navier-stokes/conserving.h"
+#include "tension-cached.h"
+#include "log-conform-EVP.h"
+#include "saramito-EVP.h"
+#include "revolve-mesh.h"
+
+#define Ldomain 8
+
+scalar mupv[], lambdav[], tau0v[];
+
+u.n[right] = neumann(0.);
+p[right] = dirichlet(0.);
+
+double B, J, Deb;
+
+static FILE * open_output (const char * outdir, const char * name)
+{
+  char path[512];
+  sprintf (path, "%s/%s", outdir, name);
+  FILE * fp = fopen (path, "w");
+  if (!fp) {
+    perror (path);
+    exit (1);
+  }
+  fprintf (ferr, "%s\n", path);
+  return fp;
+}
+
+int main (int argc, char * argv[])
+{
+  int resolution = 1024, steps = 64;
+  char outdir[256] = ".";
+  int opt;
+  while ((opt = getopt (argc, argv, "n:s:o:")) != -1)
+    switch (opt) {
+    case 'n': resolution = atoi (optarg); break;
+    case 's': steps = atoi (optarg); break;
+    case 'o': strncpy (outdir, optarg, 255); break;
+    default:
+      fprintf (ferr, "usage: %s [-n resolution] [-s steps] [-o outdir] "
+	       "B J Deb snapshot\n", argv[0]);
+      return 1;
+    }
+  if (argc - optind != 4) {
+    fprintf (ferr, "usage: %s [-n resolution] [-s steps] [-o outdir] "
+	     "B J Deb snapshot\n", argv[0]);
+    return 1;
+  }
+  B = atof(argv[optind]);
+  J = atof(argv[optind + 1]);
+  Deb = atof(argv[optind + 2]);
+
+  L0 = Ldomain;
+  origin (-L0/2., 0.);
+  init_grid (1 << 6);
+
+  rho1 = 1., rho2 = 0.001;
+  mu1 = 0.01*B, mu2 = 0.0002;
+  f.sigma = 1.0;
+
+  // allocated in the defaults event of log-conform-EVP.h when running
+  trA = new scalar;
+  solidreg = new scalar;
+
+  lambda = lambdav;
+  mup = mupv;
+  tau0 = tau0v;
+
+  if (!restore (file = argv[optind + 3])) {
+    fprintf (ferr, "export_mesh: could not restore %s\n", argv[optind + 3]);
+    return 1;
+  }
+
+  Segments s[2] = {interface_segments (f), yield_segments (solidreg, f)};
+  const char * name[2] = {"interface.ply", "yield.ply"};
+  FILE * fp;
+  for (int k = 0; k < 2; k++) {
+    Polylines l = segments_chain (&s[k]);
+    fp = open_output (outdir, name[k]);
+    revolve_ply (fp, &l, steps);
+    fclose (fp);
+    polylines_free (&l);
+    segments_free (&s[k]);
+  }
+
+  /**
+  The fields of the planes are those of python_script.py. */
+
+  scalar tp[];
+  foreach() {
+    double tr = tau_p.x.x[] + tau_p.y.y[] + tau_qq[];
+    tp[] = tr > 0. ? log10 (tr) : -10.;
+  }
+
+  fp = open_output (outdir, "plane-tp.ply");
+  meridional_plane_ply (fp, tp, hot, -1.3, 0.1, resolution,
+			box = {{-4., 0.}, {4., 8.}}, mask = {f}, side = -1);
+  fclose (fp);
+
+  fp = open_output (outdir, "plane-yield.ply");
+  meridional_plane_ply (fp, solidreg, rdbu, -1., 1., resolution,
+			box = {{-4., 0.}, {4., 8.}}, mask = {f}, side = 1);
+  fclose (fp);
+  return 0;
+}
@@ -0,0 +1,91 @@
+"""
+Reader for the level-of-detail snapshots written by output_lod()
+(01_code/output-lod.h), e.g. with -DLOD_SNAPSHOTS=1.
+
+Only the header and the blocks of levels 0 to `level` are read, that is
+a prefix of the file. The cells returned are the leaf cells of the
+coarser levels and all the cells of level `level`, which together cover
+the domain:
+
+    s = load_lod('intermediate/lod-0.9500', level=8)
+    f = s['fields']['f']           # one value per cell, at (s['x'], s['y'])
+    img = lod_raster(s, 'f')       # (2**level, 2**level) image, img[j, i]
+"""
+import numpy as np
+
+MAGIC = b'EVPLOD01'
+NAMELEN = 32
+
+
+def _pad(n):
+    return (n + 7) & ~7
+
+
+def load_lod(path, level=None):
+    with open(path, 'rb') as fp:
+        head = fp.read(64)
+        if head[:8] != MAGIC:
+            raise ValueError(f'{path}: not a level-of-detail snapshot')
+        header, nf, depth = (int(v) for v in
+                             np.frombuffer(head, dtype=np.int32, count=3, offset=8))
+        t, x0, y0, l0 = np.frombuffer(head, dtype=np.float64, count=4, offset=24)
+        rest = fp.read(header - 64)
+        names = [rest[k*NAMELEN:(k + 1)*NAMELEN].split(b'\0')[0].decode()
+                 for k in range(nf)]
+        table = np.frombuffer(rest, dtype=np.int64, count=2*(depth + 1),
+                              offset=nf*NAMELEN).reshape(-1, 2)
+        level = depth if level is None else min(level, depth)
+        offset, n = (int(v) for v in table[level])
+        end = offset + _pad(n) + (2 + nf)*_pad(4*n)
+        data = fp.read(end - header)
+
+    cells = {'level': [], 'i': [], 'j': [], 'fields': {k: [] for k in names}}
+    for l in range(level + 1):
+        start, n = (int(v) for v in table[l])
+        start -= header
+        leaf = np.frombuffer(data, dtype=np.uint8, count=n, offset=start)
+        start += _pad(n)
+        i = np.frombuffer(data, dtype=np.int32, count=n, offset=start)
+        start += _pad(4*n)
+        j = np.frombuffer(data, dtype=np.int32, count=n, offset=start)
+        start += _pad(4*n)
+        keep = np.ones(n, dtype=bool) if l == level else leaf.astype(bool)
+        cells['level'].append(np.full(keep.sum(), l, dtype=np.int32))
+        cells['i'].append(i[keep])
+        cells['j'].append(j[keep])
+        for k, name in enumerate(names):
+            v = np.frombuffer(data, dtype=np.float32, count=n,
+                              offset=start + k*_pad(4*n))
+            cells['fields'][name].append(v[keep])
+
+    lev = np.concatenate(cells['level'])
+    i, j = np.concatenate(cells['i']), np.concatenate(cells['j'])
+    delta = l0/2.0**lev
+    return {
+        't': t,
+        'level': level,
+        'depth': depth,
+        'box': (x0, y0, x0 + l0, y0 + l0),
+        'bytes': end,
+        'cell_level': lev,
+        'i': i,
+        'j': j,
+        'x': x0 + (i + 0.5)*delta,
+        'y': y0 + (j + 0.5)*delta,
+        'delta': delta,
+        'fields': {k: np.concatenate(v) for k, v in cells['fields'].items()},
+    }
+
+
+def lod_raster(s, name):
+    """Uniform (2**level, 2**level) image of a field, img[j, i]."""
+    n = 1 << s['level']
+    img = np.empty((n, n), dtype=np.float32)
+    v = s['fields'][name]
+    for l in np.unique(s['cell_level']):
+        k = s['cell_level'] == l
+        m = 1 << (s['level'] - l)
+        for a in range(m):
+            for b in range(m):
+                img[s['j'][k]*m + b, s['i'][k]*m + a] = v[k]
+    return img
@@ -0,0 +1,36 @@
+"""
+Reader for the binary raster files written by output_raster()
+(01_code/output-raster.h), e.g. by `restore_batch -b`.
+
+The pixel data are mapped with numpy.memmap, no copy or parsing is done:
+
+    r = load_raster('data-0.9500.raster')
+    tp = r['fields']['txx']        # shape (ny, nx), tp[j, i] at (x[i], y[j])
+    X, Y = np.meshgrid(r['x'], r['y'])
+"""
+import numpy as np
+
+MAGIC = b'EVPRAST1'
+NAMELEN = 32
+
+
+def load_raster(path):
+    with open(path, 'rb') as fp:
+        head = fp.read(64)
+        if head[:8] != MAGIC:
+            raise ValueError(f'{path}: not a raster file')
+        header, nx, ny, nf = np.frombuffer(head, dtype=np.int32, count=4, offset=8)
+        x0, y0, x1, y1, t = np.frombuffer(head, dtype=np.float64, count=5, offset=24)
+        names = fp.read(nf*NAMELEN)
+    names = [names[k*NAMELEN:(k + 1)*NAMELEN].split(b'\0')[0].decode()
+             for k in range(nf)]
+    data = np.memmap(path, dtype=np.float32, mode='r', offset=int(header),
+                     shape=(int(nf), int(ny), int(nx)))
+    dx, dy = (x1 - x0)/nx, (y1 - y0)/ny
+    return {
+        't': t,
+        'box': (x0, y0, x1, y1),
+        'x': x0 + dx*(np.arange(nx) + 0.5),
+        'y': y0 + dy*(np.arange(ny) + 0.5),
+        'fields': {name: data[k] for k, name in enumerate(names)},
+    }
@@ -0,0 +1,257 @@
+/**
+ * @file restore_batch.c
+ * @brief Extracts fields from many snapshots of one case in a single run.
+ *
+ * restore_data.c and restore_index.c process one snapshot per process. This
+ * tool takes any number of snapshots and a list of requested fields, spreads
+ * the snapshots over worker processes and writes, for each snapshot, all the
+ * requested fields in a single pass.
+ *
+ * Usage:
+ *   ./restore_batch [-j workers] [-n resolution] [-f fields] [-o outdir] [-b [-m]] \
+ *                   B J Deb snapshot...
+ *
+ * Fields (comma separated, default "f,ux,uy,D2,txx,txy,tyy,tqq,trA,solidreg"):
+ *   f, ux, uy, p, rho, gx, gy, txx, txy, tyy, tqq, trA, solidreg,
+ *   mup, lambda, tau0 (stored fields) and
+ *   D2 (log10 of the norm of the deformation-rate tensor),
+ *   DD (D:D), OO (S:S) and Q (flow-topology parameter, see
+ *   03_supplementary_plots/02_flow_topology_definition_2).
+ *
+ * Output: <outdir>/data-<suffix> for each intermediate/snapshot-<suffix>, in
+ * the output_field() format used by restore_data.c, or with -b
+ * <outdir>/data-<suffix>.raster in the binary format of output-raster.h
+ * (read with raster.py). The raster is sampled directly from the tree
+ * (bilinear within each leaf cell, any resolution) and, with -m, the gas
+ * (f < 1/2) is masked with NaN so that plotting scripts only need to map
+ * colours. With -l, <outdir>/lod-<suffix> is written instead in the
+ * level-of-detail format of output-lod.h (read with lod.py or previewed with
+ * 01_code/lod-preview.c), which converts existing snapshots.
+ *
+ * The exit status is non-zero if a snapshot could not be restored or its
+ * output could not be opened, in any of the workers.
+ *
+ * Compile (from this directory) without OpenMP, the parallelism comes from the
+ * worker processes:
+ *   qcc -O2 -Wall -disable-dimensions -I../01_code restore_batch.c -o restore_batch -lm
+ */
+
+#include <getopt.h>
+#include <errno.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "axi.h"
+#include "navier-stokes/centered.h"
+#include "two-phase.h"
+#include "navier-stokes/conserving.h"
+#include "tension-cached.h"
+#include "log-conform-EVP.h"
+#include "saramito-EVP.h"
+#include "output-raster.h"
+#include "output-lod.h"
+
+#define Ldomain 8
+
+scalar mupv[], lambdav[], tau0v[];
+
+// derived fields, allocated once and reused for every snapshot
+scalar D2[], DD[], OO[], Q[];
+
+u.n[right] = neumann(0.);
+p[right] = dirichlet(0.);
+
+double B, J, Deb;
+
+/**
+The invariants of the deformation-rate and rotation tensors are
+averaged over the faces of each cell, as in restore_data.c and
+restore_index.c (see velocity-gradient.h). */
+
+static void deformation_fields()
+{
+  foreach() {
+    vgrad_invariants v = face_averaged_invariants (point, u);
+    DD[] = v.DD, OO[] = v.SS;
+    D2[] = v.Dn > 0. ? log(v.Dn)/log(10) : -10;
+    Q[] = topology_Q2 (sqrt(v.DD/2.), sqrt(v.SS/2.));
+  }
+}
+
+/**
+Maps a field name to its scalar. Returns false for unknown names. */
+
+static bool lookup (const char * name, scalar * s, bool * derived)
+{
+  struct { const char * name; scalar s; bool derived; } table[] = {
+    {"f", f}, {"ux", u.x}, {"uy", u.y}, {"p", p}, {"rho", rhov},
+    {"gx", g.x}, {"gy", g.y},
+    {"txx", tau_p.x.x}, {"txy", tau_p.x.y}, {"tyy", tau_p.y.y},
+    {"tqq", tau_qq}, {"trA", trA}, {"solidreg", solidreg},
+    {"mup", mupv}, {"lambda", lambdav}, {"tau0", tau0v},
+    {"D2", D2, true}, {"DD", DD, true}, {"OO", OO, true}, {"Q", Q, true},
+  };
+  for (int k = 0; k < sizeof(table)/sizeof(table[0]); k++)
+    if (!strcmp (name, table[k].name)) {
+      *s = table[k].s, *derived = table[k].derived;
+      return true;
+    }
+  return false;
+}
+
+static void output_name (char * name, const char * outdir, const char * snapshot,
+			 bool binary, bool lod)
+{
+  const char * base = strrchr (snapshot, '/');
+  base = base ? base + 1 : snapshot;
+  const char * suffix = strrchr (base, '-');
+  sprintf (name, "%s/%s-%s%s", outdir, lod ? "lod" : "data",
+	   suffix ? suffix + 1 : base, binary && !lod ? ".raster" : "");
+}
+
+int main (int argc, char * argv[])
+{
+  int workers = 1, resolution = 1024;
+  bool binary = false, masked = false, lod = false;
+  char fields[256] = "f,ux,uy,D2,txx,txy,tyy,tqq,trA,solidreg", outdir[256] = ".";
+  int opt;
+  while ((opt = getopt (argc, argv, "j:n:f:o:bml")) != -1)
+    switch (opt) {
+    case 'j': workers = atoi (optarg); break;
+    case 'n': resolution = atoi (optarg); break;
+    case 'f': strncpy (fields, optarg, 255); break;
+    case 'o': strncpy (outdir, optarg, 255); break;
+    case 'b': binary = true; break;
+    case 'm': masked = true; break;
+    case 'l': lod = true; break;
+    default:
+      fprintf (ferr, "usage: %s [-j workers] [-n resolution] [-f fields] "
+	       "[-o outdir] [-b [-m] | -l] B J Deb snapshot...\n", argv[0]);
+      return 1;
+    }
+  if (argc - optind < 4) {
+    fprintf (ferr, "usage: %s [-j workers] [-n resolution] [-f fields] "
+	     "[-o outdir] [-b [-m] | -l] B J Deb snapshot...\n", argv[0]);
+    return 1;
+  }
+  B = atof(argv[optind]);
+  J = atof(argv[optind + 1]);
+  Deb = atof(argv[optind + 2]);
+  char ** snapshots = argv + optind + 3;
+  int nsnap = argc - optind - 3;
+
+  L0 = Ldomain;
+  origin (-L0/2., 0.);
+  init_grid (1 << 6);
+
+  rho1 = 1., rho2 = 0.001;
+  mu1 = 0.01*B, mu2 = 0.0002;
+  f.sigma = 1.0;
+
+  // allocated in the defaults event of log-conform-EVP.h when running
+  trA = new scalar;
+  solidreg = new scalar;
+
+  lambda = lambdav;
+  mup = mupv;
+  tau0 = tau0v;
+
+  /**
+  The list of output fields is built once. */
+
+  scalar * list = NULL;
+  bool derived = false;
+  for (char * name = strtok (fields, ","); name; name = strtok (NULL, ",")) {
+    scalar s;
+    bool d;
+    if (!lookup (name, &s, &d)) {
+      fprintf (ferr, "restore_batch: unknown field '%s'\n", name);
+      return 1;
+    }
+    list = list_append (list, s);
+    derived |= d;
+  }
+
+  scalar * gas = masked ? list_append (NULL, f) : NULL;
+
+  /**
+  Snapshot $k$ is processed by worker $k$ mod `workers`. Each worker
+  reuses the same fields and list for all its snapshots. The snapshots
+  of a worker which could not be forked are processed by the parent. */
+
+  if (workers > nsnap)
+    workers = nsnap;
+  if (workers < 1)
+    workers = 1;
+  int worker = 0;
+  pid_t child[workers];
+  bool mine[workers];
+  mine[0] = true;
+  for (int w = 1; w < workers; w++) {
+    mine[w] = false;
+    child[w] = fork();
+    if (child[w] == 0) {
+      worker = w;
+      break;
+    }
+    if (child[w] < 0) {
+      fprintf (ferr, "restore_batch: could not fork worker %d: %s\n",
+	       w, strerror (errno));
+      mine[w] = true;
+    }
+  }
+  if (worker > 0)
+    for (int w = 0; w < workers; w++)
+      mine[w] = (w == worker);
+
+  int failed = 0;
+  for (int w = 0; w < workers; w++)
+    for (int k = w; mine[w] && k < nsnap; k += workers) {
+      if (!restore (file = snapshots[k])) {
+	fprintf (ferr, "restore_batch: could not restore %s\n", snapshots[k]);
+	failed++;
+	continue;
+      }
+      if (derived)
+	deformation_fields();
+      char name[512];
+      output_name (name, outdir, snapshots[k], binary, lod);
+      FILE * fp = fopen (name, "w");
+      if (!fp) {
+	fprintf (ferr, "restore_batch: could not open %s: %s\n", name,
+		 strerror (errno));
+	failed++;
+	continue;
+      }
+      if (lod)
+	output_lod (list, fp);
+      else if (binary)
+	output_raster (list, fp, resolution, linear = true,
+		       box = {{-4.,0.},{4.,8.}}, mask = gas);
+      else
+	output_field (list, fp, resolution, linear = true,
+		      box = {{-4.,0.},{4.,8.}});
+      fclose (fp);
+      fprintf (ferr, "%s -> %s\n", snapshots[k], name);
+    }
+  free (list);
+  free (gas);
+
+  if (worker > 0)
+    exit (failed > 0);
+
+  /**
+  The exit status is non-zero if any snapshot failed, in any worker. */
+
+  for (int w = 1; w < workers; w++) {
+    if (child[w] <= 0)
+      continue;
+    int status;
+    if (waitpid (child[w], &status, 0) < 0 ||
+	!WIFEXITED (status) || WEXITSTATUS (status)) {
+      fprintf (ferr, "restore_batch: worker %d failed\n", w);
+      failed++;
+    }
+  }
+  return failed > 0;
+}
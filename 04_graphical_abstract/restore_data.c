@@ -10,6 +10,7 @@
 #include "fene-p-EVP.h"
 #include "distance.h"
 #include "adapt_wavelet_limited.h"
+#include "velocity-gradient.h"
 
 #define LEVEL 8
 #define MAXlevel 9
@@ -64,37 +65,15 @@ int  main(int argc, char const *argv[]) {
 
   restore(file=nameIn);
 
-    scalar D2[];
-    face vector D2f[];
-  foreach_face(x) {
-  double D11 = 0.5*( (u.y[0,1] - u.y[0,-1] + u.y[-1,1] - u.y[-1,-1])/(2.*Delta) );
-  double D22 = (u.y[] + u.y[-1, 0])/(2*max(y, 1e-20));
-  double D33 = (u.x[] - u.x[-1,0])/Delta;
-  double D13 = 0.5*( (u.y[] - u.y[-1, 0])/Delta + 0.5*( (u.x[0,1] - u.x[0,-1] + u.x[-1,1] - u.x[-1,-1])/(2.*Delta) ) );
+  /**
+  $\log_{10}$ of the face-averaged $\sqrt{\mathcal{D}:\mathcal{D}}$, in
+  one pass with the kernel of velocity-gradient.h. */
 
-  double D2temp = sqrt( sq(D11) + sq(D22) + sq(D33) + 2*sq(D13) );
-  D2f.x[] = D2temp;
-  }
-
-foreach_face(y) {
-  double D11 = (u.y[0,0] - u.y[0,-1])/Delta;
-  double D22 = (u.y[0,0] + u.y[0,-1])/(2*max(y, 1e-20));
-  double D33 = 0.5*( (u.x[1,0] - u.x[-1,0] + u.x[1,-1] - u.x[-1,-1])/(2.*Delta) );
-  double D13 = 0.5*( (u.x[0,0] - u.x[0,-1])/Delta + 0.5*( (u.y[1,0] - u.y[-1,0] + u.y[1,-1] - u.y[-1,-1])/(2.*Delta) ) );
-
-  double D2temp = sqrt( sq(D11) + sq(D22) + sq(D33) + 2*sq(D13) );
-  D2f.y[] = D2temp;
-}
-
-foreach(){
-  D2[] = (D2f.x[]+D2f.y[]+D2f.x[1,0]+D2f.y[0,1])/4.;
-  if (D2[] > 0.){
-    D2[] = log(D2[])/log(10);
-  } else {
-    D2[] = -10;
+  scalar D2[];
+  foreach() {
+    vgrad_invariants v = face_averaged_invariants (point, u);
+    D2[] = v.Dn > 0. ? log(v.Dn)/log(10) : -10;
   }
-}
-boundary({D2,D2f});
 
   FILE *fp = fopen(nameOut,"w");
   output_field({f, u.x, u.y, g.x, g.y, D2, rhov, tau_p.x.x, tau_p.y.x, tau_p.y.y, tau_qq, mupv, lambdav, tau0v, trA, solidreg},fp,1024,linear=true,box = {{-4.,0.},{4.,8.}});
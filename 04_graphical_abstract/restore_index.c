@@ -10,6 +10,7 @@
 #include "fene-p-EVP.h"
 #include "distance.h"
 #include "adapt_wavelet_limited.h"
+#include "velocity-gradient.h"
 
 #define LEVEL 8
 #define MAXlevel 9
@@ -64,59 +65,18 @@ int  main(int argc, char const *argv[]) {
 
   restore(file=nameIn);
 
-    scalar O2[];
-    face vector O2f[];
-  foreach_face(x) {
-  double O13 = 0.5*( (u.y[] - u.y[-1, 0])/Delta - 0.5*( (u.x[0,1] - u.x[0,-1] + u.x[-1,1] - u.x[-1,-1])/(2.*Delta) ) );
-  double O31 = 0.5*(0.5*( (u.x[0,1] - u.x[0,-1] + u.x[-1,1] - u.x[-1,-1])/(2.*Delta) )-  (u.y[] - u.y[-1, 0])/Delta );
-  double O2temp = sq(O13)+sq(O31);
-  O2f.x[] = O2temp;
-  }
-
-foreach_face(y) {
-  double O13 = 0.5*( (u.x[0,0] - u.x[0,-1])/Delta - 0.5*( (u.y[1,0] - u.y[-1,0] + u.y[1,-1] - u.y[-1,-1])/(2.*Delta) ) );
-  double O31 = 0.5*( 0.5*( (u.y[1,0] - u.y[-1,0] + u.y[1,-1] - u.y[-1,-1])/(2.*Delta) )-(u.x[0,0] - u.x[0,-1])/Delta );
-  double O2temp = sq(O13)+sq(O31);
-  O2f.y[] = O2temp;
-}
+  /**
+  Face-averaged $\mathcal{D}:\mathcal{D}$ (`D2`), $\mathcal{S}:\mathcal{S}$
+  (`O2`) and the flow-topology parameter (`F2`, second definition), in
+  one pass with the kernel of velocity-gradient.h. */
 
-foreach(){
-  O2[] = (O2f.x[]+O2f.y[]+O2f.x[1,0]+O2f.y[0,1])/4.;
-  }
-boundary({O2,O2f});
-
-    scalar D2[];
-    face vector D2f[];
-  foreach_face(x) {
-  double D11 = 0.5*( (u.y[0,1] - u.y[0,-1] + u.y[-1,1] - u.y[-1,-1])/(2.*Delta) );
-  double D22 = (u.y[] + u.y[-1, 0])/(2*max(y, 1e-20));
-  double D33 = (u.x[] - u.x[-1,0])/Delta;
-  double D13 = 0.5*( (u.y[] - u.y[-1, 0])/Delta + 0.5*( (u.x[0,1] - u.x[0,-1] + u.x[-1,1] - u.x[-1,-1])/(2.*Delta) ) );
-
-  double D2temp = sq(D11) + sq(D22) + sq(D33) + 2*sq(D13);
-  D2f.x[] = D2temp;
+  scalar D2[], O2[], F2[];
+  foreach() {
+    vgrad_invariants v = face_averaged_invariants (point, u);
+    D2[] = v.DD, O2[] = v.SS;
+    F2[] = topology_Q2 (sqrt(v.DD/2.), sqrt(v.SS/2.));
   }
 
-foreach_face(y) {
-  double D11 = (u.y[0,0] - u.y[0,-1])/Delta;
-  double D22 = (u.y[0,0] + u.y[0,-1])/(2*max(y, 1e-20));
-  double D33 = 0.5*( (u.x[1,0] - u.x[-1,0] + u.x[1,-1] - u.x[-1,-1])/(2.*Delta) );
-  double D13 = 0.5*( (u.x[0,0] - u.x[0,-1])/Delta + 0.5*( (u.y[1,0] - u.y[-1,0] + u.y[1,-1] - u.y[-1,-1])/(2.*Delta) ) );
-
-  double D2temp = sq(D11) + sq(D22) + sq(D33) + 2*sq(D13);
-  D2f.y[] = D2temp;
-}
-
-foreach(){
-  D2[] = (D2f.x[]+D2f.y[]+D2f.x[1,0]+D2f.y[0,1])/4.;
-}
-boundary({D2,D2f});
-
-scalar F2[];
-foreach(){
-  F2[] = (sqrt(D2[]/2.) - sqrt(O2[]/2.))/(sqrt(D2[]/2.) + sqrt(O2[]/2.));
-}
-
   FILE *fp = fopen(nameOut,"w");
   output_field({f, D2, O2, F2, solidreg},fp,1024,linear=true,box = {{-4.,0.},{4.,8.}});
 